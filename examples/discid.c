@@ -28,6 +28,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <discid/discid.h>
 
 #ifndef DISCID_HAVE_SPARSE_READ
@@ -100,6 +101,13 @@ int main(int argc, char *argv[]) {
 
 	printf("DiscID        : %s\n", discid_get_id(disc));
 	printf("FreeDB DiscID : %s\n", discid_get_freedb_id(disc));
+	printf("AccurateRip ID: %s\n", discid_get_accuraterip_id(disc));
+	printf("CTDB TOC ID   : %s\n", discid_get_ctdb_id(disc));
+	if (strcmp(discid_get_full_id(disc), discid_get_id(disc)) != 0) {
+		printf("Full DiscID   : %s\n", discid_get_full_id(disc));
+		printf("Full FreeDB ID: %s\n",
+		       discid_get_full_freedb_id(disc));
+	}
 
 	first_track = discid_get_first_track_num(disc);
 	last_track = discid_get_last_track_num(disc);
@@ -0,0 +1,80 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Print the DiscIDs of disc images.
+ *
+ * Every parameter is a CUE sheet, cdrdao TOC file, CloneCD CCD file
+ * or FLAC file with a CUESHEET.
+ * For each of them one line with the MusicBrainz DiscID, the FreeDB DiscID
+ * and the path is printed, errors go to stderr.
+ *
+ * With -t the parameters are the audio files of one disc, one per track,
+ * like "discimage -t album/track*.flac".
+ */
+#include <stdio.h>
+#include <string.h>
+#include <discid/discid.h>
+
+
+int main(int argc, char *argv[]) {
+	DiscId *disc;
+	int i, failed = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s IMAGE.cue|IMAGE.toc|IMAGE.ccd...\n"
+			"       %s -t TRACK.wav|TRACK.flac|TRACK.aiff...\n",
+			argv[0], argv[0]);
+		return 2;
+	}
+
+	disc = discid_new();
+
+	if (strcmp(argv[1], "-t") == 0) {
+		if (discid_read_files(disc, argc - 2,
+				      (const char **) argv + 2)) {
+			printf("%s %s %s\n", discid_get_id(disc),
+			       discid_get_freedb_id(disc),
+			       discid_get_toc_string(disc));
+		} else {
+			fprintf(stderr, "Error: %s\n",
+				discid_get_error_msg(disc));
+			failed++;
+		}
+		discid_free(disc);
+		return failed > 0;
+	}
+
+	for (i = 1; i < argc; i++) {
+		if (discid_read_image(disc, argv[i])) {
+			printf("%s %s %s\n", discid_get_id(disc),
+			       discid_get_freedb_id(disc), argv[i]);
+		} else {
+			fprintf(stderr, "Error: %s\n",
+				discid_get_error_msg(disc));
+			failed++;
+		}
+	}
+
+	discid_free(disc);
+
+	return failed > 0;
+}
+
+/* EOF */
@@ -0,0 +1,247 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Build and query a DiscID index.
+ *
+ *   discindex build INDEX CDTOC MEDIUM_CDTOC
+ *	builds the index from the "cdtoc" and "medium_cdtoc" files
+ *	of the MusicBrainz database dump (mbdump.tar.bz2)
+ *   discindex lookup INDEX DISCID...
+ *	prints the cdtoc and medium ids for the DiscIDs
+ *   discindex read INDEX [DEVICE]
+ *	reads the disc in the drive and prints its cdtoc and medium ids
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <discid/discid.h>
+
+#define LINE_LENGTH	4096
+
+
+typedef struct {
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	int known;
+} cdtoc_row;
+
+static cdtoc_row *cdtocs;
+static unsigned long num_cdtocs;
+
+
+/* Return the given tab separated column of a line, changes the line */
+static char *get_column(char *line, int column) {
+	char *end;
+
+	while (column-- > 0) {
+		line = strchr(line, '\t');
+		if (line == NULL)
+			return NULL;
+		line++;
+	}
+	end = strpbrk(line, "\t\r\n");
+	if (end != NULL)
+		*end = '\0';
+	return line;
+}
+
+/* Read the cdtoc file: id, discid, freedb_id, ... */
+static int read_cdtocs(const char *path) {
+	char line[LINE_LENGTH];
+	cdtoc_row *rows;
+	unsigned long id, size = 0;
+	const char *discid;
+	FILE *file;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return 0;
+	while (fgets(line, sizeof line, file) != NULL) {
+		id = strtoul(line, NULL, 10);
+		discid = get_column(line, 1);
+		if (id == 0 || discid == NULL)
+			continue;
+		if (id >= size) {
+			size = id * 2 + 1024;
+			rows = realloc(cdtocs, size * sizeof(cdtoc_row));
+			if (rows == NULL) {
+				fclose(file);
+				return 0;
+			}
+			memset(rows + num_cdtocs, 0,
+			       (size - num_cdtocs) * sizeof(cdtoc_row));
+			cdtocs = rows;
+			num_cdtocs = size;
+		}
+		if (discid_id_decode(discid, cdtocs[id].digest)) {
+			cdtocs[id].known = 1;
+		} else {
+			fprintf(stderr, "Warning: invalid DiscID in cdtoc %lu\n",
+				id);
+		}
+	}
+	fclose(file);
+
+	return 1;
+}
+
+/* Read the medium_cdtoc file: id, medium, cdtoc, ... */
+static discid_index_entry *read_mediums(const char *path, size_t *count) {
+	char line[LINE_LENGTH];
+	discid_index_entry *entries = NULL, *bigger;
+	size_t size = 0;
+	unsigned long medium, cdtoc;
+	const char *column;
+	FILE *file;
+
+	*count = 0;
+	file = fopen(path, "r");
+	if (file == NULL)
+		return NULL;
+	while (fgets(line, sizeof line, file) != NULL) {
+		column = get_column(line, 1);
+		if (column == NULL)
+			continue;
+		medium = strtoul(column, NULL, 10);
+		column = get_column((char *) column + strlen(column) + 1, 0);
+		cdtoc = strtoul(column, NULL, 10);
+		if (cdtoc >= num_cdtocs || !cdtocs[cdtoc].known)
+			continue;
+
+		if (*count == size) {
+			size = size * 2 + 65536;
+			bigger = realloc(entries,
+					 size * sizeof(discid_index_entry));
+			if (bigger == NULL) {
+				free(entries);
+				fclose(file);
+				return NULL;
+			}
+			entries = bigger;
+		}
+		memcpy(entries[*count].digest, cdtocs[cdtoc].digest,
+		       DISCID_DIGEST_LENGTH);
+		entries[*count].cdtoc = (unsigned int) cdtoc;
+		entries[*count].medium = (unsigned int) medium;
+		(*count)++;
+	}
+	fclose(file);
+
+	return entries;
+}
+
+static int build(const char *index_path, const char *cdtoc_path,
+		 const char *medium_cdtoc_path) {
+	discid_index_entry *entries;
+	size_t count;
+	int ok;
+
+	if (!read_cdtocs(cdtoc_path)) {
+		fprintf(stderr, "Error: cannot read %s\n", cdtoc_path);
+		return 1;
+	}
+	entries = read_mediums(medium_cdtoc_path, &count);
+	if (entries == NULL) {
+		fprintf(stderr, "Error: cannot read %s\n", medium_cdtoc_path);
+		free(cdtocs);
+		return 1;
+	}
+
+	ok = discid_index_build(index_path, entries, count);
+	if (ok)
+		printf("%lu entries written to %s\n", (unsigned long) count,
+		       index_path);
+	else
+		fprintf(stderr, "Error: cannot write %s\n", index_path);
+
+	free(entries);
+	free(cdtocs);
+
+	return !ok;
+}
+
+static void print_entries(const char *id, const discid_index_entry *entries,
+			  size_t count) {
+	size_t i;
+
+	if (count == 0)
+		printf("%s not found\n", id);
+	for (i = 0; i < count; i++) {
+		printf("%s cdtoc %u medium %u\n", id, entries[i].cdtoc,
+		       entries[i].medium);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	discid_index *index;
+	const discid_index_entry *entries;
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	DiscId *disc;
+	size_t count;
+	int i, failed = 0;
+
+	if (argc == 5 && strcmp(argv[1], "build") == 0)
+		return build(argv[2], argv[3], argv[4]);
+
+	if (argc < 3 || (strcmp(argv[1], "lookup") != 0
+			 && strcmp(argv[1], "read") != 0)) {
+		fprintf(stderr, "Usage: %s build INDEX CDTOC MEDIUM_CDTOC\n"
+			"       %s lookup INDEX DISCID...\n"
+			"       %s read INDEX [DEVICE]\n",
+			argv[0], argv[0], argv[0]);
+		return 2;
+	}
+
+	index = discid_index_open(argv[2]);
+	if (index == NULL) {
+		fprintf(stderr, "Error: cannot open index %s\n", argv[2]);
+		return 1;
+	}
+
+	if (strcmp(argv[1], "lookup") == 0) {
+		for (i = 3; i < argc; i++) {
+			if (!discid_id_decode(argv[i], digest)) {
+				fprintf(stderr, "Error: invalid DiscID %s\n",
+					argv[i]);
+				failed++;
+				continue;
+			}
+			count = discid_index_lookup_digest(index, digest,
+							   &entries);
+			print_entries(argv[i], entries, count);
+		}
+	} else {
+		disc = discid_new();
+		if (discid_read_sparse(disc, argc > 3 ? argv[3] : NULL, 0)) {
+			count = discid_index_lookup(index, disc, &entries);
+			print_entries(discid_get_id(disc), entries, count);
+		} else {
+			fprintf(stderr, "Error: %s\n",
+				discid_get_error_msg(disc));
+			failed++;
+		}
+		discid_free(disc);
+	}
+
+	discid_index_close(index);
+
+	return failed > 0;
+}
+
+/* EOF */
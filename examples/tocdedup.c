@@ -0,0 +1,277 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Group the TOCs of a huge list by DiscID, with bounded memory.
+ *
+ * Every input line is a timestamp, a tab and a TOC string as returned by
+ * discid_get_toc_string(): "first last lead-out offset...".
+ * The output has one line per DiscID with the number of rows,
+ * the first and the last timestamp, sorted by binary DiscID.
+ *
+ *   tocdedup [-m MEGABYTES] [-t THREADS] < rows > ids
+ *
+ * The DiscIDs are computed in batches with discid_compute_batch().
+ * The records are collected until the memory limit is reached,
+ * then sorted, merged and written to a temporary file (a run).
+ * At the end all runs are merged with a heap.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <discid/discid.h>
+
+#define LINE_LENGTH	1024
+#define BATCH_SIZE	16384
+#define MAX_RUNS	4096
+
+typedef struct {
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	unsigned long count;
+	long first_seen;
+	long last_seen;
+} record;
+
+typedef struct {
+	FILE *file;
+	record head;
+} run;
+
+static discid_toc tocs[BATCH_SIZE];
+static discid_result results[BATCH_SIZE];
+static long timestamps[BATCH_SIZE];
+
+static record *records;
+static size_t num_records, max_records;
+static run runs[MAX_RUNS];
+static int num_runs;
+
+
+static int compare_records(const void *a, const void *b) {
+	return memcmp(((const record *) a)->digest,
+		      ((const record *) b)->digest, DISCID_DIGEST_LENGTH);
+}
+
+/* Add the counts and times of b to a */
+static void merge_record(record *a, const record *b) {
+	a->count += b->count;
+	if (b->first_seen < a->first_seen)
+		a->first_seen = b->first_seen;
+	if (b->last_seen > a->last_seen)
+		a->last_seen = b->last_seen;
+}
+
+/* Sort the records in memory and write them as a run */
+static int spill_run(void) {
+	size_t i, out = 0;
+	FILE *file;
+
+	if (num_records == 0)
+		return 1;
+	if (num_runs == MAX_RUNS) {
+		fprintf(stderr, "Error: too many runs, use more memory\n");
+		return 0;
+	}
+
+	qsort(records, num_records, sizeof(record), compare_records);
+	for (i = 1; i < num_records; i++) {
+		if (compare_records(&records[out], &records[i]) == 0)
+			merge_record(&records[out], &records[i]);
+		else
+			records[++out] = records[i];
+	}
+	num_records = out + 1;
+
+	file = tmpfile();
+	if (file == NULL
+	    || fwrite(records, sizeof(record), num_records, file)
+			!= num_records
+	    || fseek(file, 0, SEEK_SET) != 0) {
+		fprintf(stderr, "Error: cannot write a temporary file\n");
+		return 0;
+	}
+	runs[num_runs++].file = file;
+	num_records = 0;
+
+	return 1;
+}
+
+static int add_batch(size_t count, int threads, unsigned long *invalid) {
+	record *r;
+	size_t i;
+
+	discid_compute_batch(tocs, count, results, threads);
+	for (i = 0; i < count; i++) {
+		if (!results[i].success) {
+			(*invalid)++;
+			continue;
+		}
+		if (num_records == max_records && !spill_run())
+			return 0;
+		r = &records[num_records++];
+		memcpy(r->digest, results[i].digest, DISCID_DIGEST_LENGTH);
+		r->count = 1;
+		r->first_seen = r->last_seen = timestamps[i];
+	}
+
+	return 1;
+}
+
+/* Parse "timestamp<TAB>first last lead-out offset..." */
+static int parse_row(const char *line, long *timestamp, discid_toc *toc) {
+	char *rest;
+	int i;
+
+	memset(toc, 0, sizeof(discid_toc));
+	*timestamp = strtol(line, &rest, 10);
+	if (rest == line)
+		return 0;
+	toc->first = (int) strtol(rest, &rest, 10);
+	toc->last = (int) strtol(rest, &rest, 10);
+	if (toc->first < 1 || toc->last < toc->first || toc->last > 99)
+		return 0;
+	toc->offsets[0] = (int) strtol(rest, &rest, 10);
+	for (i = toc->first; i <= toc->last; i++) {
+		toc->offsets[i] = (int) strtol(rest, &rest, 10);
+	}
+	return 1;
+}
+
+static int read_head(run *r) {
+	return fread(&r->head, sizeof(record), 1, r->file) == 1;
+}
+
+/* Restore the heap order below position i */
+static void sift_down(run *heap[], int size, int i) {
+	run *tmp;
+	int child;
+
+	while ((child = 2 * i + 1) < size) {
+		if (child + 1 < size && compare_records(&heap[child + 1]->head,
+							&heap[child]->head) < 0)
+			child++;
+		if (compare_records(&heap[child]->head, &heap[i]->head) >= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+static void print_record(const record *r) {
+	char id[DISCID_ID_LENGTH + 1];
+
+	discid_id_encode(r->digest, id);
+	printf("%s\t%lu\t%ld\t%ld\n", id, r->count, r->first_seen,
+	       r->last_seen);
+}
+
+/* Merge all runs, combining the records of the same DiscID */
+static unsigned long merge_runs(void) {
+	run *heap[MAX_RUNS];
+	record current;
+	unsigned long ids = 0;
+	int size = 0, i;
+
+	for (i = 0; i < num_runs; i++) {
+		if (read_head(&runs[i]))
+			heap[size++] = &runs[i];
+	}
+	for (i = size / 2 - 1; i >= 0; i--) {
+		sift_down(heap, size, i);
+	}
+
+	while (size > 0) {
+		current = heap[0]->head;
+		if (!read_head(heap[0]))
+			heap[0] = heap[--size];
+		sift_down(heap, size, 0);
+
+		while (size > 0
+		       && compare_records(&heap[0]->head, &current) == 0) {
+			merge_record(&current, &heap[0]->head);
+			if (!read_head(heap[0]))
+				heap[0] = heap[--size];
+			sift_down(heap, size, 0);
+		}
+		print_record(&current);
+		ids++;
+	}
+
+	return ids;
+}
+
+int main(int argc, char *argv[]) {
+	char line[LINE_LENGTH];
+	unsigned long rows = 0, invalid = 0, ids;
+	size_t count = 0;
+	long megabytes = 256;
+	int threads = 0, i;
+
+	for (i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-m") == 0) {
+			megabytes = atol(argv[i + 1]);
+		} else if (strcmp(argv[i], "-t") == 0) {
+			threads = atoi(argv[i + 1]);
+		} else {
+			break;
+		}
+	}
+	if (i < argc || megabytes <= 0) {
+		fprintf(stderr, "Usage: %s [-m MEGABYTES] [-t THREADS]"
+			" < ROWS > IDS\n", argv[0]);
+		return 2;
+	}
+
+	max_records = (size_t) megabytes * 1024 * 1024 / sizeof(record);
+	records = malloc(max_records * sizeof(record));
+	if (records == NULL) {
+		fprintf(stderr, "Error: cannot allocate %ld MB\n", megabytes);
+		return 1;
+	}
+
+	while (fgets(line, sizeof line, stdin) != NULL) {
+		rows++;
+		if (!parse_row(line, &timestamps[count], &tocs[count])) {
+			invalid++;
+			continue;
+		}
+		if (++count == BATCH_SIZE) {
+			if (!add_batch(count, threads, &invalid))
+				return 1;
+			count = 0;
+		}
+	}
+	if (!add_batch(count, threads, &invalid) || !spill_run())
+		return 1;
+	free(records);
+
+	ids = merge_runs();
+	for (i = 0; i < num_runs; i++) {
+		fclose(runs[i].file);
+	}
+
+	fprintf(stderr, "%lu rows, %lu invalid, %lu DiscIDs in %d runs\n",
+		rows, invalid, ids, num_runs);
+
+	return 0;
+}
+
+/* EOF */
@@ -0,0 +1,214 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Compute the MusicBrainz DiscIDs for a freedb/gnudb dump.
+ *
+ * The dump is an uncompressed tar file of xmcd files, read sequentially
+ * from the given file or stdin ("-"), like "bzcat freedb.tar.bz2 |
+ * xmcdimport -". For every record one line is printed with the
+ * MusicBrainz DiscID, the FreeDB DiscID computed from the TOC,
+ * "ok" or "mismatch" for the comparison with the stored DISCID
+ * and the path in the tar file.
+ *
+ * The xmcd files only have the disc length in seconds, so the lead-out
+ * is the start of that second. The MusicBrainz DiscID is correct when
+ * the lead-out was on a full second, the FreeDB DiscID always is.
+ * Records are collected and computed in parallel with
+ * discid_compute_batch().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <discid/discid.h>
+
+#define BLOCK_SIZE	512
+#define BATCH_SIZE	4096
+#define MAX_RECORD	65536
+
+typedef struct {
+	char path[256];
+	char discids[128];
+} record_info;
+
+static discid_toc tocs[BATCH_SIZE];
+static discid_result results[BATCH_SIZE];
+static record_info records[BATCH_SIZE];
+static char text[MAX_RECORD + BLOCK_SIZE + 1];
+
+static long num_records, num_valid, num_mismatches;
+
+
+/* Parse an xmcd file, returns 0 if it has no usable TOC */
+static int parse_xmcd(char *line, discid_toc *toc, char discids[],
+		      size_t discids_size) {
+	char *next, *p;
+	int in_offsets = 0, tracks = 0;
+	long seconds = 0;
+
+	discids[0] = '\0';
+	for (; line != NULL; line = next) {
+		next = strchr(line, '\n');
+		if (next != NULL)
+			*next++ = '\0';
+
+		if (line[0] == '#') {
+			p = line + 1;
+			while (isspace((unsigned char) *p))
+				p++;
+			if (in_offsets && isdigit((unsigned char) *p)) {
+				if (++tracks > 99)
+					return 0;
+				toc->offsets[tracks] = atoi(p);
+			} else if (strncmp(p, "Track frame offsets", 19) == 0) {
+				in_offsets = 1;
+			} else {
+				in_offsets = 0;
+				if (strncmp(p, "Disc length:", 12) == 0)
+					seconds = atol(p + 12);
+			}
+		} else if (strncmp(line, "DISCID=", 7) == 0) {
+			/* there may be more than one line */
+			if (discids[0] != '\0'
+					&& strlen(discids) + 1 < discids_size)
+				strcat(discids, ",");
+			strncat(discids, line + 7,
+				discids_size - strlen(discids) - 1);
+		}
+	}
+
+	if (tracks < 1 || seconds <= 0)
+		return 0;
+	toc->first = 1;
+	toc->last = tracks;
+	toc->offsets[0] = (int) (seconds * 75);
+	return 1;
+}
+
+static void flush_batch(size_t count, int threads) {
+	size_t i;
+	int match;
+
+	discid_compute_batch(tocs, count, results, threads);
+
+	for (i = 0; i < count; i++) {
+		if (!results[i].success) {
+			fprintf(stderr, "Error: %s: %s\n", records[i].path,
+				results[i].error_msg);
+			continue;
+		}
+		match = strstr(records[i].discids, results[i].freedb_id) != NULL;
+		num_valid++;
+		num_mismatches += !match;
+		printf("%s %s %s %s\n", results[i].id, results[i].freedb_id,
+		       match ? "ok" : "mismatch", records[i].path);
+	}
+}
+
+static int is_zero_block(const unsigned char block[]) {
+	int i;
+
+	for (i = 0; i < BLOCK_SIZE; i++) {
+		if (block[i] != 0)
+			return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned char header[BLOCK_SIZE];
+	char size_field[13];
+	FILE *file;
+	size_t count = 0;
+	long size, blocks;
+	int threads = 0;
+	int regular;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s TARFILE|- [THREADS]\n", argv[0]);
+		return 2;
+	}
+	if (argc > 2)
+		threads = atoi(argv[2]);
+
+	if (strcmp(argv[1], "-") == 0) {
+		file = stdin;
+	} else {
+		file = fopen(argv[1], "rb");
+		if (file == NULL) {
+			fprintf(stderr, "Error: cannot open %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	while (fread(header, 1, BLOCK_SIZE, file) == BLOCK_SIZE
+			&& !is_zero_block(header)) {
+		memcpy(size_field, header + 124, 12);
+		size_field[12] = '\0';
+		size = strtol(size_field, NULL, 8);
+		blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		regular = header[156] == '0' || header[156] == '\0';
+
+		if (!regular || size > MAX_RECORD) {
+			/* skip, but keep reading sequentially */
+			while (blocks-- > 0
+			       && fread(header, 1, BLOCK_SIZE, file)
+					== BLOCK_SIZE)
+				;
+			continue;
+		}
+
+		if (fread(text, BLOCK_SIZE, (size_t) blocks, file)
+				!= (size_t) blocks)
+			break;
+		text[size] = '\0';
+		num_records++;
+
+		/* ustar has a prefix for long names */
+		if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != 0)
+			sprintf(records[count].path, "%.155s/%.100s",
+				(char *) header + 345, (char *) header);
+		else
+			sprintf(records[count].path, "%.100s",
+				(char *) header);
+
+		if (!parse_xmcd(text, &tocs[count], records[count].discids,
+				sizeof records[count].discids)) {
+			fprintf(stderr, "Error: %s: no TOC found\n",
+				records[count].path);
+			continue;
+		}
+		if (++count == BATCH_SIZE) {
+			flush_batch(count, threads);
+			count = 0;
+		}
+	}
+	flush_batch(count, threads);
+
+	if (file != stdin)
+		fclose(file);
+
+	fprintf(stderr, "%ld records, %ld valid, %ld FreeDB ID mismatches\n",
+		num_records, num_valid, num_mismatches);
+
+	return 0;
+}
+
+/* EOF */
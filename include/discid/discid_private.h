@@ -33,6 +33,14 @@
 
 #include "discid/discid.h"
 
+#if defined(_MSC_VER)
+#	define THREAD_LOCAL __declspec(thread)
+#elif (defined(__GNUC__) && (__GNUC__ >= 4)) || defined(__clang__)
+#	define THREAD_LOCAL __thread
+#else
+#	define THREAD_LOCAL
+#endif
+
 #ifdef DISCID_USE_HTTPS
 #define MB_URL_PROTOCOL "https"
 #else
@@ -52,6 +60,14 @@
 /* Length of a FreeDB DiscID in bytes (without a trailing '\0'-byte). */
 #define FREEDB_DISC_ID_LENGTH	8
 
+/* Length of an AccurateRip disc ID in bytes (without a trailing '\0'-byte):
+ * track count with 3 digits and three 32 bit values in hex */
+#define ACCURATERIP_ID_LENGTH	(3 + 3 * (1 + 8))
+
+/* Length of the message hashed for a MusicBrainz DiscID:
+ * first and last track with 2 hex digits, 100 offsets with 8 hex digits */
+#define MB_DIGEST_MESSAGE_LENGTH	(2 + 2 + 100*8)
+
 /* The maximum permitted length for an error message (without the '\0'-byte). */
 #define MB_ERROR_MSG_LENGTH		255
 
@@ -73,11 +89,56 @@
 /* Maximum length of a ISRC code string */
 #define ISRC_STR_LENGTH		12
 
+/* Size of a CD-TEXT pack in bytes, including the CRC */
+#define MB_CDTEXT_PACK_SIZE	18
+
+/* Number of CD-TEXT text fields, see enum discid_cdtext_field */
+#define MB_CDTEXT_FIELDS	6
+
+/* Size of the pool for all CD-TEXT strings of a disc:
+ * the text of one block with 256 packs of 12 characters */
+#define MB_CDTEXT_POOL_LENGTH	(256 * 12)
+
+/* Maximum length of a device name (including the '\0'-byte) */
+#define MB_DEVICE_NAME_LENGTH	50
+
+/* Maximum length of a device key for the persistent TOC cache
+ * (including the '\0'-byte) */
+#define MB_CACHE_KEY_LENGTH	64
+
+/* Gap between the last audio track and a data track in a second session
+ * on multi-session (CD-Extra) discs, in frames/sectors */
+#define XA_INTERVAL		((60 + 90 + 2) * 75)
+
+/* Bit set in the control field of a TOC entry for data tracks */
+#define DATA_TRACK		0x04
+
+/* Error message for discs without audio tracks (DISCID_ERROR_NO_AUDIO) */
+#define MB_NO_AUDIO_MSG	"no actual audio tracks on disc: CDROM or DVD?"
+
+/* Error message for a disc changed during a background read
+ * (DISCID_ERROR_MEDIA_CHANGED) */
+#define MB_MEDIA_CHANGED_MSG	"the disc was changed while it was read"
+
 /* Maximum disc length in frames/sectors
  * This is already not according to spec, but many players might still work
  * Spec is 79:59.75 = 360000 + lead-in + lead-out */
 #define MAX_DISC_LENGTH		(90 * 60 * 75)
 
+/* A background read started by discid_read_progressive() */
+struct mb_disc_background;
+
+typedef struct {
+	int control;
+	int address;
+} mb_disc_toc_track;
+
+typedef struct {
+	int first_track_num;
+	int last_track_num;
+	mb_disc_toc_track tracks[100];
+} mb_disc_toc;
+
 /*
  * This data structure represents an audio disc.
  *
@@ -89,28 +150,29 @@ typedef struct {
 	int first_track_num;
 	int last_track_num;
 	int track_offsets[100];
+	unsigned char digest[DISCID_DIGEST_LENGTH];
 	char id[MB_DISC_ID_LENGTH+1];
 	char freedb_id[FREEDB_DISC_ID_LENGTH+1];
+	char accuraterip_id[ACCURATERIP_ID_LENGTH+1];
+	char ctdb_id[MB_DISC_ID_LENGTH+1];
+	mb_disc_toc toc;
+	unsigned char full_digest[DISCID_DIGEST_LENGTH];
+	char full_id[MB_DISC_ID_LENGTH+1];
+	char full_freedb_id[FREEDB_DISC_ID_LENGTH+1];
 	char submission_url[MB_MAX_URL_LENGTH+1];
 	char webservice_url[MB_MAX_URL_LENGTH+1];
 	char toc_string[MB_TOC_STRING_LENGTH+1];
 	char error_msg[MB_ERROR_MSG_LENGTH+1];
+	int error_code;
 	char isrc[100][ISRC_STR_LENGTH+1];
 	char mcn[MCN_STR_LENGTH+1];
+	unsigned short cdtext[100][MB_CDTEXT_FIELDS];
+	char cdtext_pool[MB_CDTEXT_POOL_LENGTH];
+	int track_pregaps[100];
 	int success;
+	struct mb_disc_background *background;
 } mb_disc_private;
 
-typedef struct {
-	int control;
-	int address;
-} mb_disc_toc_track;
-
-typedef struct {
-	int first_track_num;
-	int last_track_num;
-	mb_disc_toc_track tracks[100];
-} mb_disc_toc;
-
 /*
  * This function has to be implemented once per operating system.
  *
@@ -125,13 +187,68 @@ typedef struct {
  */
 LIBDISCID_INTERNAL int mb_disc_read_unportable(mb_disc_private *disc, const char *device, unsigned int features);
 
+/*
+ * Read the MCN, ISRCs, CD-TEXT and pregaps given in features for the
+ * disc in device, without reading the TOC again. The TOC of disc has to
+ * be set already, by mb_disc_read_unportable() or a copy of its result.
+ *
+ * On error, 0 is returned. On success, 1 is returned.
+ */
+LIBDISCID_INTERNAL int mb_disc_read_features_unportable(mb_disc_private *disc,
+							const char *device,
+							unsigned int features);
+
 
 /*
- * This should return the name of the default/preferred CDROM/DVD device
- * on this operating system. It has to be in a format usable for the second
+ * This should write the name of the default/preferred CDROM/DVD device
+ * on this operating system to the device buffer of the given length.
+ * It has to be in a format usable for the second
  * parameter of mb_disc_read_unportable().
+ *
+ * Implementations may not use static buffers, this has to be reentrant.
+ *
+ * Returns 1 if the name fit into the buffer, 0 if it was truncated.
  */
-LIBDISCID_INTERNAL char *mb_disc_get_default_device_unportable(void);
+LIBDISCID_INTERNAL int mb_disc_get_default_device_unportable(char *device,
+							     int device_length);
+
+/*
+ * Read only the TOC header, the lead-out and the entries for the count
+ * track numbers in tracks that the disc has, into toc.
+ * Implementations may read more entries if that doesn't take
+ * additional commands.
+ *
+ * On error or if this isn't supported, 0 is returned.
+ * On success, 1 is returned.
+ */
+LIBDISCID_INTERNAL int mb_disc_read_toc_summary_unportable(
+		mb_disc_private *disc, const char *device,
+		mb_disc_toc *toc, const int tracks[], int count);
+
+/*
+ * Check whether the disc in device has the TOC of disc, which has to be
+ * read successfully. Only the TOC summary is read for that, see
+ * mb_disc_read_toc_summary_unportable().
+ *
+ * Returns 1 if the TOC is the same and 0 otherwise or on error.
+ */
+LIBDISCID_INTERNAL int mb_disc_same_disc(mb_disc_private *disc,
+					 const char *device);
+
+/*
+ * Check whether the medium in the device is still the one that was there
+ * on the previous call for this device, also across processes.
+ * Every call resets the media change state of the device.
+ *
+ * A key identifying the device is written to the key buffer,
+ * it is used as part of a file name by the persistent TOC cache.
+ *
+ * Returns 1 if the medium is known to be unchanged, 0 if it changed and
+ * -1 if this can't be determined on this platform or for this device.
+ */
+LIBDISCID_INTERNAL int mb_disc_media_unchanged_unportable(const char *device,
+							  char key[],
+							  int key_length);
 
 /*
  * This should return 1 if the feature is supported by the platform
@@ -141,9 +258,150 @@ LIBDISCID_INTERNAL int mb_disc_has_feature_unportable(enum discid_feature featur
 
 /*
  * Load data to the mb_disc_private structure based on mb_disc_toc.
+ * The TOC itself is kept as well, for the IDs of the full TOC.
  *
  * On error, 0 is returned. On success, 1 is returned.
  */
 LIBDISCID_INTERNAL int mb_disc_load_toc(mb_disc_private *disc, mb_disc_toc *toc);
 
+/*
+ * Check TOC data with the rules of discid_put().
+ *
+ * Returns NULL if the TOC is valid and a static error message otherwise.
+ */
+LIBDISCID_INTERNAL const char *mb_disc_check_toc(int first, int last,
+						 const int offsets[]);
+
+/*
+ * Create the SHA-1 digest of the TOC data, the binary MusicBrainz DiscID.
+ * The digest is placed in the provided buffer of DISCID_DIGEST_LENGTH bytes.
+ * Only offsets up to the last track are used.
+ */
+LIBDISCID_INTERNAL void mb_disc_create_digest(int first, int last,
+					      const int offsets[],
+					      unsigned char digest[]);
+
+/*
+ * Create a FreeDB DiscID based on the TOC data.
+ * The DiscID is placed in the provided string buffer.
+ */
+LIBDISCID_INTERNAL void mb_disc_create_freedb_id(int last,
+						 const int offsets[],
+						 char buf[]);
+
+/*
+ * Create an AccurateRip disc ID based on the TOC data and the FreeDB DiscID
+ * created by mb_disc_create_freedb_id().
+ * The ID is placed in the provided string buffer.
+ */
+LIBDISCID_INTERNAL void mb_disc_create_accuraterip_id(int first, int last,
+						      const int offsets[],
+						      const char freedb_id[],
+						      char buf[]);
+
+/*
+ * Create a CUETools database TOC ID based on the TOC data.
+ * The ID is placed in the provided string buffer.
+ */
+LIBDISCID_INTERNAL void mb_disc_create_ctdb_id(int first, int last,
+					       const int offsets[], char buf[]);
+
+/*
+ * Look up the TOC of disc in the cache enabled by discid_cache_enable().
+ * On a hit, digest, id, freedb_id, accuraterip_id, ctdb_id and
+ * toc_string are filled in.
+ *
+ * Returns 1 on a hit and 0 on a miss or if the cache is disabled.
+ */
+LIBDISCID_INTERNAL int mb_disc_cache_lookup(mb_disc_private *disc);
+
+/*
+ * Store digest, id, freedb_id, accuraterip_id, ctdb_id and toc_string
+ * of disc in the cache, if it is enabled.
+ */
+LIBDISCID_INTERNAL void mb_disc_cache_store(mb_disc_private *disc);
+
+/*
+ * Return 1 if the persistent TOC cache is enabled by
+ * discid_toc_cache_enable() and 0 otherwise.
+ */
+LIBDISCID_INTERNAL int mb_disc_toc_cache_enabled(void);
+
+/*
+ * Load the TOC, MCN and ISRCs stored for the device key from the
+ * persistent TOC cache. Fails if the requested features weren't stored.
+ *
+ * On a miss or error, 0 is returned. On success, 1 is returned.
+ */
+LIBDISCID_INTERNAL int mb_disc_toc_cache_load(mb_disc_private *disc,
+					      const char *key,
+					      unsigned int features);
+
+/*
+ * Store the TOC, MCN and ISRCs of disc read with the given features
+ * for the device key in the persistent TOC cache.
+ */
+LIBDISCID_INTERNAL void mb_disc_toc_cache_store(mb_disc_private *disc,
+						const char *key,
+						unsigned int features);
+
+/*
+ * Remove what is stored for the device key from the persistent TOC cache,
+ * when the medium changed or the stored TOC turned out to be wrong.
+ */
+LIBDISCID_INTERNAL void mb_disc_toc_cache_remove(const char *key);
+
+/*
+ * Decode count CD-TEXT packs of MB_CDTEXT_PACK_SIZE bytes, as returned by
+ * READ TOC/PMA/ATIP format 5 without the header, into the cdtext table and
+ * pool of disc. Packs with a wrong CRC are left out.
+ *
+ * Returns 1 if any text pack was valid and 0 otherwise.
+ */
+LIBDISCID_INTERNAL int mb_disc_load_cdtext(mb_disc_private *disc,
+					   const unsigned char *packs,
+					   int count);
+
+/*
+ * Read the track number from the Q sub-channel of the sector at lba.
+ * Returns 1 if it was read, 0 if the sector has no position in Q
+ * (but the MCN or an ISRC) and -1 if it can't be read.
+ */
+typedef int (*mb_disc_q_reader)(void *data, int lba, int *track_num);
+
+/*
+ * Find the pregaps of all tracks but the first of disc with a binary
+ * search over the Q sub-channel read by read_q, which gets data.
+ * The pregaps that can't be read are set to -1.
+ */
+LIBDISCID_INTERNAL void mb_disc_find_pregaps(mb_disc_private *disc,
+					     mb_disc_q_reader read_q,
+					     void *data);
+
+/*
+ * Read the TOC, MCN and ISRCs from the description file of a disc image,
+ * a CUE sheet, cdrdao TOC file, CloneCD CCD file or FLAC file.
+ *
+ * On error, 0 is returned. On success, 1 is returned.
+ */
+LIBDISCID_INTERNAL int mb_disc_read_image(mb_disc_private *disc,
+					  const char *path);
+
+/*
+ * Calculate the track offsets of a disc with one audio file per track,
+ * from the lengths in the file headers, as needed by discid_put().
+ *
+ * On error, 0 is returned. On success, 1 is returned.
+ */
+LIBDISCID_INTERNAL int mb_disc_get_file_offsets(mb_disc_private *disc,
+			int count, const char *paths[], int offsets[]);
+
+/*
+ * Wait for a background read of disc to finish, if there is one,
+ * and release it. This has to be done before the object is reset or freed.
+ *
+ * Returns 0 if the background read failed and 1 otherwise.
+ */
+LIBDISCID_INTERNAL int mb_disc_join_background(mb_disc_private *disc);
+
 #endif /* MUSICBRAINZ_DISC_ID_PRIVATE_H */
@@ -64,10 +64,6 @@
  *
  */
 
-#include <ctype.h>
-#include <stdio.h>
-#include <time.h>
-#include <stdlib.h>
 #include "base64.h"
 
 /* NOTE: This is not true RFC822 anymore. The use of the characters
@@ -75,36 +71,98 @@
    '_', '.', and '-' have been used instead
 */
 
-/* Convert binary contents to BASE64
- * Accepts: source
- *	    length of source
- *	    pointer to return destination length
- * Returns: destination as BASE64
+/* The BASE64 alphabet with '.' and '_' in place of '+' and '/'.
+ * Disc IDs are padded with '-' instead of '='.
  */
+static const char mb_base64_alphabet[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._";
 
-unsigned char *rfc822_binary (void *src,unsigned long srcl,unsigned long *len)
+/* Reverse lookup table for mb_base64_alphabet.
+ * Valid characters map to their 6 bit value, all other characters
+ * map to MB_BASE64_INVALID, so a whole group of four characters can be
+ * checked with a single OR instead of one branch per character.
+ */
+#define MB_BASE64_INVALID 0x40
+#define XX MB_BASE64_INVALID
+static const unsigned char mb_base64_values[256] = {
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,62,XX,
+  52,53,54,55,56,57,58,59, 60,61,XX,XX,XX,XX,XX,XX,
+  XX, 0, 1, 2, 3, 4, 5, 6,  7, 8, 9,10,11,12,13,14,
+  15,16,17,18,19,20,21,22, 23,24,25,XX,XX,XX,XX,63,
+  XX,26,27,28,29,30,31,32, 33,34,35,36,37,38,39,40,
+  41,42,43,44,45,46,47,48, 49,50,51,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX,
+  XX,XX,XX,XX,XX,XX,XX,XX, XX,XX,XX,XX,XX,XX,XX,XX
+};
+#undef XX
+
+/* Convert a 20 byte SHA-1 digest to a 28 character disc ID
+ * Accepts: source digest
+ *	    destination buffer with room for 29 characters
+ *
+ * The 20 bytes are 6 full groups of three, giving 24 characters, and
+ * two bytes left over. These give three more characters and one '-'
+ * as padding. No line breaks are inserted.
+ */
+
+void mb_base64_encode_digest (const unsigned char *src,char *dst)
 {
-  unsigned char *ret,*d;
-  unsigned char *s = (unsigned char *) src;
-  char *v = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._";
-  unsigned long i = ((srcl + 2) / 3) * 4;
-  *len = i += 2 * ((i / 60) + 1);
-  d = ret = (unsigned char *) malloc ((size_t) ++i);
-  for (i = 0; srcl; s += 3) {	/* process tuplets */
-    *d++ = v[s[0] >> 2];	/* byte 1: high 6 bits (1) */
-				/* byte 2: low 2 bits (1), high 4 bits (2) */
-    *d++ = v[((s[0] << 4) + (--srcl ? (s[1] >> 4) : 0)) & 0x3f];
-				/* byte 3: low 4 bits (2), high 2 bits (3) */
-    *d++ = srcl ? v[((s[1] << 2) + (--srcl ? (s[2] >> 6) : 0)) & 0x3f] : '-';
-				/* byte 4: low 6 bits (3) */
-    *d++ = srcl ? v[s[2] & 0x3f] : '-';
-    if (srcl) srcl--;		/* count third character if processed */
-    if ((++i) == 15) {		/* output 60 characters? */
-      i = 0;			/* restart line break count, insert CRLF */
-      *d++ = '\015'; *d++ = '\012';
-    }
+  int i;
+  unsigned long t;
+  for (i = 0; i < 18; i += 3) {	/* 6 full tuplets */
+    t = ((unsigned long) src[i] << 16) | (src[i+1] << 8) | src[i+2];
+    *dst++ = mb_base64_alphabet[(t >> 18) & 0x3f];
+    *dst++ = mb_base64_alphabet[(t >> 12) & 0x3f];
+    *dst++ = mb_base64_alphabet[(t >> 6) & 0x3f];
+    *dst++ = mb_base64_alphabet[t & 0x3f];
   }
-  *d = '\0';			/* tie off string */
+				/* remaining 2 bytes, one pad character */
+  t = ((unsigned long) src[18] << 16) | (src[19] << 8);
+  *dst++ = mb_base64_alphabet[(t >> 18) & 0x3f];
+  *dst++ = mb_base64_alphabet[(t >> 12) & 0x3f];
+  *dst++ = mb_base64_alphabet[(t >> 6) & 0x3f];
+  *dst++ = '-';
+  *dst = '\0';			/* tie off string */
+}
 
-  return ret;			/* return the resulting string */
+/* Convert a 28 character disc ID back to the 20 byte SHA-1 digest
+ * Accepts: source disc ID (doesn't need to be '\0'-terminated)
+ *	    destination buffer with room for 20 bytes
+ * Returns: 1 if the disc ID was valid, 0 otherwise
+ *
+ * Only the canonical encoding as produced by mb_base64_encode_digest()
+ * is accepted. The loop is kept free of data dependent branches.
+ */
+
+int mb_base64_decode_digest (const char *src,unsigned char *dst)
+{
+  const unsigned char *s = (const unsigned char *) src;
+  unsigned long t;
+  unsigned char a,b,c,d,bad = 0;
+  int i;
+  for (i = 0; i < 18; i += 3, s += 4) {
+    a = mb_base64_values[s[0]]; b = mb_base64_values[s[1]];
+    c = mb_base64_values[s[2]]; d = mb_base64_values[s[3]];
+    bad |= a | b | c | d;
+    t = ((unsigned long) a << 18) | (b << 12) | (c << 6) | d;
+    dst[i] = (unsigned char) (t >> 16);
+    dst[i+1] = (unsigned char) (t >> 8);
+    dst[i+2] = (unsigned char) t;
+  }
+  a = mb_base64_values[s[0]]; b = mb_base64_values[s[1]];
+  c = mb_base64_values[s[2]];
+  bad |= a | b | c;
+  t = ((unsigned long) a << 18) | (b << 12) | (c << 6);
+  dst[18] = (unsigned char) (t >> 16);
+  dst[19] = (unsigned char) (t >> 8);
+				/* unused low bits have to be zero */
+  return !(bad & MB_BASE64_INVALID) && !(c & 0x03) && s[3] == '-';
 }
@@ -69,6 +69,7 @@
 
 #include "discid/discid.h" /* for LIBDISCID_INTERNAL */
 
-LIBDISCID_INTERNAL unsigned char *rfc822_binary (void *src,unsigned long srcl,unsigned long *len);
+LIBDISCID_INTERNAL void mb_base64_encode_digest (const unsigned char *src,char *dst);
+LIBDISCID_INTERNAL int mb_base64_decode_digest (const char *src,unsigned char *dst);
 
 #endif
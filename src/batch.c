@@ -0,0 +1,169 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <assert.h>
+
+#include "base64.h"
+#include "thread.h"
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+/* Number of rows a thread computes before taking the next range.
+ * Large enough to make the locking irrelevant,
+ * small enough to balance uneven threads. */
+#define BATCH_CHUNK	1024
+/* Same for reading files, where every row is much slower */
+#define FILE_BATCH_CHUNK	16
+
+/* in case reading the image failed without saying why */
+static const char *const image_error_msg = "cannot read the image";
+
+
+typedef struct {
+	const discid_toc *tocs;
+	discid_result *results;
+} batch_job;
+
+typedef struct {
+	const char **paths;
+	discid_result *results;
+} image_batch_job;
+
+
+static void set_error(discid_result *result, const char *error_msg) {
+	result->success = 0;
+	result->error_msg = error_msg;
+	result->error_buffer[0] = '\0';
+	memset(result->digest, 0, sizeof result->digest);
+	result->id[0] = '\0';
+	result->freedb_id[0] = '\0';
+	result->accuraterip_id[0] = '\0';
+	result->ctdb_id[0] = '\0';
+}
+
+static void compute_result(discid_result *result, int first, int last,
+			   const int offsets[]) {
+	mb_disc_create_digest(first, last, offsets, result->digest);
+	mb_base64_encode_digest(result->digest, result->id);
+	mb_disc_create_freedb_id(last, offsets, result->freedb_id);
+	mb_disc_create_accuraterip_id(first, last, offsets, result->freedb_id,
+				      result->accuraterip_id);
+	mb_disc_create_ctdb_id(first, last, offsets, result->ctdb_id);
+	result->error_msg = NULL;
+	result->error_buffer[0] = '\0';
+	result->success = 1;
+}
+
+static void compute_range(void *arg, size_t begin, size_t end) {
+	batch_job *job = (batch_job *) arg;
+	const discid_toc *toc;
+	const char *error_msg;
+	size_t i;
+
+	for (i = begin; i < end; i++) {
+		toc = &job->tocs[i];
+
+		error_msg = mb_disc_check_toc(toc->first, toc->last,
+					      toc->offsets);
+		if (error_msg != NULL)
+			set_error(&job->results[i], error_msg);
+		else
+			compute_result(&job->results[i], toc->first,
+				       toc->last, toc->offsets);
+	}
+}
+
+/* Keep the error message of the image in the result */
+static void set_image_error(discid_result *result, const char *error_msg) {
+	if (error_msg[0] == '\0')
+		error_msg = image_error_msg;
+	set_error(result, result->error_buffer);
+	strncpy(result->error_buffer, error_msg, DISCID_ERROR_MSG_LENGTH);
+	result->error_buffer[DISCID_ERROR_MSG_LENGTH] = '\0';
+}
+
+static void read_image_range(void *arg, size_t begin, size_t end) {
+	image_batch_job *job = (image_batch_job *) arg;
+	mb_disc_private disc;
+	size_t i;
+
+	for (i = begin; i < end; i++) {
+		memset(&disc, 0, sizeof disc);
+		if (mb_disc_read_image(&disc, job->paths[i]))
+			compute_result(&job->results[i], disc.first_track_num,
+				       disc.last_track_num,
+				       disc.track_offsets);
+		else
+			set_image_error(&job->results[i], disc.error_msg);
+	}
+}
+
+size_t discid_compute_batch(const discid_toc *tocs, size_t count,
+			    discid_result *results, int threads) {
+	batch_job job;
+	size_t i, valid;
+
+	assert(tocs != NULL || count == 0);
+	assert(results != NULL || count == 0);
+
+	job.tocs = tocs;
+	job.results = results;
+	mb_parallel_for(count, BATCH_CHUNK, threads, compute_range, &job);
+
+	valid = 0;
+	for (i = 0; i < count; i++) {
+		valid += results[i].success;
+	}
+
+	return valid;
+}
+
+size_t discid_read_image_batch(const char *paths[], size_t count,
+			       discid_result *results, int threads) {
+	image_batch_job job;
+	size_t i, valid;
+
+	assert(paths != NULL || count == 0);
+	assert(results != NULL || count == 0);
+
+	job.paths = paths;
+	job.results = results;
+	mb_parallel_for(count, FILE_BATCH_CHUNK, threads, read_image_range,
+			&job);
+
+	valid = 0;
+	for (i = 0; i < count; i++) {
+		valid += results[i].success;
+	}
+
+	return valid;
+}
+
+/* EOF */
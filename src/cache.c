@@ -0,0 +1,215 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * In-process cache for the IDs derived from a TOC.
+ *
+ * The cache is split into shards with their own lock, so threads
+ * working on different TOCs rarely wait for each other.
+ * Every shard is a direct mapped table: a TOC can only be stored
+ * in one slot, which is simply overwritten by the next TOC mapping there.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "thread.h"
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+#define CACHE_SHARDS	16
+
+
+typedef struct {
+	int used;
+	unsigned long fingerprint;
+	int first_track_num;
+	int last_track_num;
+	int track_offsets[100];
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	char id[MB_DISC_ID_LENGTH+1];
+	char freedb_id[FREEDB_DISC_ID_LENGTH+1];
+	char accuraterip_id[ACCURATERIP_ID_LENGTH+1];
+	char ctdb_id[MB_DISC_ID_LENGTH+1];
+	char toc_string[MB_TOC_STRING_LENGTH+1];
+} cache_entry;
+
+typedef struct {
+	mb_mutex lock;
+	cache_entry *entries;
+	size_t hits;
+	size_t misses;
+} cache_shard;
+
+static cache_shard shards[CACHE_SHARDS];
+/* 0 if the cache is disabled */
+static size_t shard_size = 0;
+
+
+/* FNV-1a hash over the track numbers and offsets up to the last track */
+static unsigned long create_fingerprint(mb_disc_private *d) {
+	unsigned long hash = 2166136261UL;
+	int i;
+
+	hash = ((hash ^ d->first_track_num) * 16777619UL) & 0xffffffffUL;
+	hash = ((hash ^ d->last_track_num) * 16777619UL) & 0xffffffffUL;
+	for (i = 0; i <= d->last_track_num; i++) {
+		hash = ((hash ^ (unsigned long) d->track_offsets[i])
+			* 16777619UL) & 0xffffffffUL;
+	}
+	return hash;
+}
+
+static int same_toc(cache_entry *entry, mb_disc_private *d) {
+	return entry->first_track_num == d->first_track_num
+		&& entry->last_track_num == d->last_track_num
+		&& memcmp(entry->track_offsets, d->track_offsets,
+			  sizeof(int) * (d->last_track_num + 1)) == 0;
+}
+
+int mb_disc_cache_lookup(mb_disc_private *d) {
+	unsigned long fingerprint;
+	cache_shard *shard;
+	cache_entry *entry;
+	int found;
+
+	if (shard_size == 0)
+		return 0;
+
+	fingerprint = create_fingerprint(d);
+	shard = &shards[fingerprint % CACHE_SHARDS];
+
+	mb_mutex_lock(&shard->lock);
+	entry = &shard->entries[(fingerprint / CACHE_SHARDS) % shard_size];
+	found = entry->used && entry->fingerprint == fingerprint
+		&& same_toc(entry, d);
+	if (found) {
+		memcpy(d->digest, entry->digest, sizeof d->digest);
+		memcpy(d->id, entry->id, sizeof d->id);
+		memcpy(d->freedb_id, entry->freedb_id, sizeof d->freedb_id);
+		memcpy(d->accuraterip_id, entry->accuraterip_id,
+		       sizeof d->accuraterip_id);
+		memcpy(d->ctdb_id, entry->ctdb_id, sizeof d->ctdb_id);
+		memcpy(d->toc_string, entry->toc_string,
+		       sizeof d->toc_string);
+		shard->hits++;
+	} else {
+		shard->misses++;
+	}
+	mb_mutex_unlock(&shard->lock);
+
+	return found;
+}
+
+void mb_disc_cache_store(mb_disc_private *d) {
+	unsigned long fingerprint;
+	cache_shard *shard;
+	cache_entry *entry;
+
+	if (shard_size == 0)
+		return;
+
+	fingerprint = create_fingerprint(d);
+	shard = &shards[fingerprint % CACHE_SHARDS];
+
+	mb_mutex_lock(&shard->lock);
+	entry = &shard->entries[(fingerprint / CACHE_SHARDS) % shard_size];
+	entry->used = 1;
+	entry->fingerprint = fingerprint;
+	entry->first_track_num = d->first_track_num;
+	entry->last_track_num = d->last_track_num;
+	memcpy(entry->track_offsets, d->track_offsets,
+	       sizeof entry->track_offsets);
+	memcpy(entry->digest, d->digest, sizeof entry->digest);
+	memcpy(entry->id, d->id, sizeof entry->id);
+	memcpy(entry->freedb_id, d->freedb_id, sizeof entry->freedb_id);
+	memcpy(entry->accuraterip_id, d->accuraterip_id,
+	       sizeof entry->accuraterip_id);
+	memcpy(entry->ctdb_id, d->ctdb_id, sizeof entry->ctdb_id);
+	memcpy(entry->toc_string, d->toc_string, sizeof entry->toc_string);
+	mb_mutex_unlock(&shard->lock);
+}
+
+int discid_cache_enable(size_t entries) {
+	size_t size;
+	int i;
+
+	discid_cache_disable();
+
+	size = (entries + CACHE_SHARDS - 1) / CACHE_SHARDS;
+	if (size == 0)
+		return 0;
+
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		shards[i].entries = calloc(size, sizeof(cache_entry));
+		if (shards[i].entries == NULL) {
+			while (i-- > 0) {
+				free(shards[i].entries);
+				shards[i].entries = NULL;
+			}
+			return 0;
+		}
+	}
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		mb_mutex_init(&shards[i].lock);
+		shards[i].hits = 0;
+		shards[i].misses = 0;
+	}
+	shard_size = size;
+
+	return 1;
+}
+
+void discid_cache_disable(void) {
+	int i;
+
+	if (shard_size == 0)
+		return;
+
+	shard_size = 0;
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		mb_mutex_destroy(&shards[i].lock);
+		free(shards[i].entries);
+		shards[i].entries = NULL;
+	}
+}
+
+void discid_cache_get_stats(size_t *hits, size_t *misses) {
+	int i;
+
+	assert(hits != NULL);
+	assert(misses != NULL);
+
+	*hits = 0;
+	*misses = 0;
+	for (i = 0; i < CACHE_SHARDS && shard_size > 0; i++) {
+		mb_mutex_lock(&shards[i].lock);
+		*hits += shards[i].hits;
+		*misses += shards[i].misses;
+		mb_mutex_unlock(&shards[i].lock);
+	}
+}
+
+/* EOF */
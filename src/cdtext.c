@@ -0,0 +1,149 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Decoding of the CD-TEXT packs returned by READ TOC/PMA/ATIP format 5.
+ *
+ * Every pack has 18 bytes: pack type, track number, sequence number,
+ * block number and character position, 12 bytes of text and a CRC.
+ * The strings of one pack type follow each other with a '\0' at the end,
+ * one per track starting with the track number of the pack, 0 for the disc.
+ * A string of a single tab means "the same as the previous track".
+ */
+
+#include <string.h>
+#include <assert.h>
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+#define PACK_TITLE		0x80
+#define PACK_TEXT_LENGTH	12
+
+/* the longest text per track and field the standard allows */
+#define CDTEXT_ITEM_LENGTH	160
+
+
+typedef struct {
+	int track;	/* -1 before the first pack of the field */
+	int skip;	/* the pack started within a lost string */
+	int length;
+	char text[CDTEXT_ITEM_LENGTH + 1];
+} field_state;
+
+
+/* CRC-16 CCITT (x^16 + x^12 + x^5 + 1), stored inverted */
+static int check_crc(const unsigned char *pack) {
+	unsigned int crc = 0;
+	int i, bit;
+
+	for (i = 0; i < MB_CDTEXT_PACK_SIZE - 2; i++) {
+		crc ^= (unsigned int) pack[i] << 8;
+		for (bit = 0; bit < 8; bit++) {
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	crc = ~crc & 0xffff;
+
+	return pack[16] == (crc >> 8) && pack[17] == (crc & 0xff);
+}
+
+static void store_text(mb_disc_private *disc, int field, field_state *state,
+		       int *pool_used) {
+	int track = state->track;
+
+	if (track < 0 || track > 99 || state->length == 0)
+		return;
+
+	state->text[state->length] = '\0';
+	if (strcmp(state->text, "\t") == 0) {
+		if (track > 0)
+			disc->cdtext[track][field] =
+				disc->cdtext[track - 1][field];
+	} else if (*pool_used + state->length + 1 <= MB_CDTEXT_POOL_LENGTH) {
+		memcpy(disc->cdtext_pool + *pool_used, state->text,
+		       state->length + 1);
+		disc->cdtext[track][field] = (unsigned short) *pool_used;
+		*pool_used += state->length + 1;
+	}
+}
+
+int mb_disc_load_cdtext(mb_disc_private *disc, const unsigned char *packs,
+			int count) {
+	field_state states[MB_CDTEXT_FIELDS];
+	field_state *state;
+	const unsigned char *pack;
+	int pool_used, found, field, track, i, j;
+
+	assert(disc != NULL);
+	assert(packs != NULL || count == 0);
+
+	memset(disc->cdtext, 0, sizeof disc->cdtext);
+	/* offset 0 is the empty string for missing fields */
+	disc->cdtext_pool[0] = '\0';
+	pool_used = 1;
+	found = 0;
+
+	for (i = 0; i < MB_CDTEXT_FIELDS; i++) {
+		states[i].track = -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		pack = packs + i * MB_CDTEXT_PACK_SIZE;
+		field = pack[0] - PACK_TITLE;
+		/* only single byte text of the first block (language) */
+		if (field < 0 || field >= MB_CDTEXT_FIELDS
+				|| (pack[3] & 0x70) != 0 || pack[3] & 0x80)
+			continue;
+
+		state = &states[field];
+		track = pack[1] & 0x7f;
+		if (!check_crc(pack)) {
+			/* the string continued in this pack is lost */
+			state->track = -1;
+			continue;
+		}
+		found = 1;
+
+		if (state->track != track) {
+			/* first pack or after a lost one: start over */
+			state->track = track;
+			state->skip = (pack[3] & 0x0f) > 0;
+			state->length = 0;
+		}
+
+		for (j = 4; j < 4 + PACK_TEXT_LENGTH; j++) {
+			if (pack[j] == '\0') {
+				if (!state->skip)
+					store_text(disc, field, state,
+						   &pool_used);
+				state->skip = 0;
+				state->length = 0;
+				state->track++;
+			} else if (!state->skip
+				   && state->length < CDTEXT_ITEM_LENGTH) {
+				state->text[state->length++] = (char) pack[j];
+			}
+		}
+	}
+
+	return found;
+}
+
+/* EOF */
@@ -0,0 +1,91 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Comparing the TOCs of two DiscId objects.
+ *
+ * The differences of the track offsets are reduced to their minimum
+ * and maximum in one loop without branches, which compilers can
+ * vectorize. Everything else is derived from these two values.
+ */
+
+#include <string.h>
+#include <assert.h>
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+
+int discid_compare(DiscId *a, DiscId *b, discid_comparison *result) {
+	mb_disc_private *x = (mb_disc_private *) a;
+	mb_disc_private *y = (mb_disc_private *) b;
+	const int *offsets_x, *offsets_y;
+	int tracks_x, tracks_y, tracks, i;
+	int delta, min_delta, max_delta, above, below;
+	const mb_disc_private *longer, *shorter;
+
+	assert(x != NULL);
+	assert(y != NULL);
+	assert(result != NULL);
+
+	memset(result, 0, sizeof(discid_comparison));
+	if (!x->success || !y->success)
+		return 0;
+
+	tracks_x = x->last_track_num - x->first_track_num + 1;
+	tracks_y = y->last_track_num - y->first_track_num + 1;
+	tracks = tracks_x < tracks_y ? tracks_x : tracks_y;
+	offsets_x = x->track_offsets + x->first_track_num;
+	offsets_y = y->track_offsets + y->first_track_num;
+
+	min_delta = max_delta = offsets_y[0] - offsets_x[0];
+	for (i = 1; i < tracks; i++) {
+		delta = offsets_y[i] - offsets_x[i];
+		min_delta = delta < min_delta ? delta : min_delta;
+		max_delta = delta > max_delta ? delta : max_delta;
+	}
+
+	result->same_tracks = tracks_x == tracks_y
+		&& x->first_track_num == y->first_track_num;
+	result->shift = offsets_y[0] - offsets_x[0];
+	result->leadout_delta = y->track_offsets[0] - x->track_offsets[0];
+	above = max_delta - result->shift;
+	below = result->shift - min_delta;
+	result->max_deviation = above > below ? above : below;
+	result->constant_shift = result->same_tracks && min_delta == max_delta
+		&& result->leadout_delta == min_delta;
+
+	/* equal, or equal but for a data track at the end of one of them */
+	if (min_delta != 0 || max_delta != 0
+			|| x->first_track_num != y->first_track_num) {
+		result->xa_equal = 0;
+	} else if (tracks_x == tracks_y) {
+		result->xa_equal = result->leadout_delta == 0;
+	} else if (tracks_x - tracks_y == 1 || tracks_y - tracks_x == 1) {
+		longer = tracks_x > tracks_y ? x : y;
+		shorter = tracks_x > tracks_y ? y : x;
+		result->xa_equal = shorter->track_offsets[0]
+			== longer->track_offsets[longer->last_track_num]
+				- XA_INTERVAL;
+	}
+
+	return 1;
+}
+
+/* EOF */
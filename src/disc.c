@@ -30,6 +30,7 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
@@ -44,12 +45,26 @@
 #define TRACK_NUM_IS_VALID(disc, i) \
 	( i >= disc->first_track_num && i <= disc->last_track_num )
 
+#define FULL_TRACK_NUM_IS_VALID(disc, i) \
+	( i >= disc->toc.first_track_num && i <= disc->toc.last_track_num )
 
-static void create_disc_id(mb_disc_private *d, char buf[]);
-static void create_freedb_disc_id(mb_disc_private *d, char buf[]);
-static char *create_toc_string(mb_disc_private *d, char *sep);
+/* TOC entries compared to recognize a known disc, see get_summary_tracks() */
+#define SUMMARY_TRACKS	4
+
+
+static void create_toc_string(mb_disc_private *d, char *sep, char buf[]);
 static void create_submission_url(mb_disc_private *d, char buf[]);
 static void create_webservice_url(mb_disc_private *d, char buf[]);
+static void create_derived_values(mb_disc_private *d);
+static void create_toc(mb_disc_private *d);
+static int get_full_offsets(mb_disc_private *d, int offsets[]);
+static void create_full_ids(mb_disc_private *d);
+static int get_summary_tracks(mb_disc_private *d, int tracks[]);
+static int same_toc_summary(mb_disc_private *d, mb_disc_toc *toc,
+			    const int tracks[], int count);
+static size_t add_variants(int first, int last, const int offsets[],
+			   int leadout, int range, discid_variant variants[],
+			   size_t count, size_t max_variants);
 
 
 /****************************************************************************
@@ -65,6 +80,10 @@ DiscId *discid_new() {
 
 
 void discid_free(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+
+	if (disc != NULL)
+		mb_disc_join_background(disc);
 	free(d);
 }
 
@@ -76,6 +95,18 @@ char *discid_get_error_msg(DiscId *d) {
 	return disc->error_msg;
 }
 
+int discid_get_error_code(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+
+	if (disc->error_msg[0] == '\0')
+		return DISCID_ERROR_NONE;
+	else if (disc->error_code == DISCID_ERROR_NONE)
+		return DISCID_ERROR_OTHER;
+	else
+		return disc->error_code;
+}
+
 
 char *discid_get_id(DiscId *d) {
 	mb_disc_private *disc = (mb_disc_private *) d;
@@ -85,13 +116,60 @@ char *discid_get_id(DiscId *d) {
 	if (!disc->success)
 		return NULL;
 
-	if (strlen(disc->id) == 0)
-		create_disc_id(disc, disc->id);
-
 	return disc->id;
 }
 
 
+int discid_get_id_binary(DiscId *d, unsigned char digest[]) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+	assert(digest != NULL);
+
+	if (!disc->success)
+		return 0;
+
+	memcpy(digest, disc->digest, DISCID_DIGEST_LENGTH);
+
+	return 1;
+}
+
+
+void discid_id_encode(const unsigned char digest[], char id[]) {
+	assert(digest != NULL);
+	assert(id != NULL);
+
+	mb_base64_encode_digest(digest, id);
+}
+
+
+int discid_id_decode(const char *id, unsigned char digest[]) {
+	assert(id != NULL);
+	assert(digest != NULL);
+
+	if (strlen(id) != DISCID_ID_LENGTH)
+		return 0;
+
+	return mb_base64_decode_digest(id, digest);
+}
+
+
+size_t discid_id_decode_bulk(const char *ids, size_t count,
+			     unsigned char *digests) {
+	size_t i;
+	assert(ids != NULL || count == 0);
+	assert(digests != NULL || count == 0);
+
+	for (i = 0; i < count; i++) {
+		if (!mb_base64_decode_digest(ids + i * DISCID_ID_LENGTH,
+					     digests + i * DISCID_DIGEST_LENGTH))
+			break;
+	}
+
+	return i;
+}
+
+
 char *discid_get_freedb_id(DiscId *d) {
 	mb_disc_private *disc = (mb_disc_private *) d;
 	assert(disc != NULL);
@@ -100,12 +178,31 @@ char *discid_get_freedb_id(DiscId *d) {
 	if (!disc->success)
 		return NULL;
 
-	if (strlen(disc->freedb_id) == 0)
-		create_freedb_disc_id(disc, disc->freedb_id);
-
 	return disc->freedb_id;
 }
 
+char *discid_get_accuraterip_id(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+
+	if (!disc->success)
+		return NULL;
+
+	return disc->accuraterip_id;
+}
+
+char *discid_get_ctdb_id(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+
+	if (!disc->success)
+		return NULL;
+
+	return disc->ctdb_id;
+}
+
 char *discid_get_toc_string(DiscId *d) {
 	mb_disc_private *disc = (mb_disc_private *) d;
 	assert( disc != NULL );
@@ -114,14 +211,6 @@ char *discid_get_toc_string(DiscId *d) {
 	if ( ! disc->success )
 		return NULL;
 
-	if ( strlen(disc->toc_string) == 0 ) {
-		char *toc = create_toc_string(disc, " ");
-		if (toc) {
-			memcpy(disc->toc_string, toc, strlen(toc) + 1);
-			free(toc);
-		}
-	}
-
 	return disc->toc_string;
 }
 
@@ -133,9 +222,6 @@ char *discid_get_submission_url(DiscId *d) {
 	if (!disc->success)
 		return NULL;
 
-	if (strlen(disc->submission_url) == 0)
-		create_submission_url(disc, disc->submission_url);
-
 	return disc->submission_url;
 }
 
@@ -147,9 +233,6 @@ char *discid_get_webservice_url(DiscId *d) {
 	if (!disc->success)
 		return NULL;
 
-	if (strlen(disc->webservice_url) == 0)
-		create_webservice_url(disc, disc->webservice_url);
-
 	return disc->webservice_url;
 }
 
@@ -159,16 +242,46 @@ int discid_read(DiscId *d, const char *device) {
 
 int discid_read_sparse(DiscId *d, const char *device, unsigned int features) {
 	mb_disc_private *disc = (mb_disc_private *) d;
+	char default_device[MB_DEVICE_NAME_LENGTH];
+	char cache_key[MB_CACHE_KEY_LENGTH];
+	int unchanged = -1;
 	assert(disc != NULL);
 
-	if (device == NULL)
-		device = discid_get_default_device();
+	if (device == NULL) {
+		mb_disc_get_default_device_unportable(default_device,
+						      sizeof default_device);
+		device = default_device;
+	}
 
 	assert(device != NULL);
 
 	/* Necessary, because the disc handle could have been used before. */
+	mb_disc_join_background(disc);
 	memset(disc, 0, sizeof(mb_disc_private));
 
+	/* the same medium as last time doesn't have to be read again */
+	if (mb_disc_toc_cache_enabled()) {
+		unchanged = mb_disc_media_unchanged_unportable(device,
+				cache_key, sizeof cache_key);
+		if (unchanged == 0) {
+			/* The query cleared the media change, so the old TOC
+			 * has to go before the read, which might fail. */
+			mb_disc_toc_cache_remove(cache_key);
+		} else if (unchanged == 1
+			&& mb_disc_toc_cache_load(disc, cache_key, features)) {
+			/* Any other program can clear the media change as
+			 * well, so the cheap parts of the TOC are checked. */
+			if (mb_disc_same_disc(disc, device)) {
+				disc->error_msg[0] = '\0';
+				disc->success = 1;
+				create_derived_values(disc);
+				return 1;
+			}
+			mb_disc_toc_cache_remove(cache_key);
+			memset(disc, 0, sizeof(mb_disc_private));
+		}
+	}
+
 	/* pre-read the TOC to reduce "not-ready" problems
 	 * See LIB-44 (issues with multi-session discs)
 	 */
@@ -177,57 +290,195 @@ int discid_read_sparse(DiscId *d, const char *device, unsigned int features) {
 	}
 	memset(disc, 0, sizeof(mb_disc_private));
 
-	return disc->success = mb_disc_read_unportable(disc, device, features);
+	disc->success = mb_disc_read_unportable(disc, device, features);
+
+	if (disc->success) {
+		if (unchanged >= 0)
+			mb_disc_toc_cache_store(disc, cache_key, features);
+		create_derived_values(disc);
+	}
+
+	return disc->success;
 }
 
-int discid_put(DiscId *d, int first, int last, int *offsets) {
-	int i, disc_length;
+int discid_read_quick(DiscId *d, const char *device, unsigned int features) {
 	mb_disc_private *disc = (mb_disc_private *) d;
+	char default_device[MB_DEVICE_NAME_LENGTH];
 	assert(disc != NULL);
 
+	if (device == NULL) {
+		mb_disc_get_default_device_unportable(default_device,
+						      sizeof default_device);
+		device = default_device;
+	}
+
+	/* a background read of the known disc finishes first */
+	mb_disc_join_background(disc);
+
+	if (disc->success && mb_disc_same_disc(disc, device)) {
+		disc->error_msg[0] = '\0';
+		return 2;
+	}
+
+	return discid_read_sparse(d, device, features);
+}
+
+int discid_read_image(DiscId *d, const char *path) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(path != NULL);
+
 	/* Necessary, because the disc handle could have been used before. */
+	mb_disc_join_background(disc);
 	memset(disc, 0, sizeof(mb_disc_private));
 
-	/* extensive checking of given parameters */
-	if (first > last || first < 1
-			|| first > 99 || last < 1 || last > 99) {
+	disc->success = mb_disc_read_image(disc, path);
 
-		sprintf(disc->error_msg, "Illegal track limits");
-		return 0;
-	}
-	if (offsets == NULL) {
-		sprintf(disc->error_msg, "No offsets given");
+	if (disc->success)
+		create_derived_values(disc);
+
+	return disc->success;
+}
+
+int discid_read_files(DiscId *d, int count, const char *paths[]) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	int offsets[100];
+	assert(disc != NULL);
+	assert(paths != NULL);
+
+	/* Necessary, because the disc handle could have been used before. */
+	mb_disc_join_background(disc);
+	memset(disc, 0, sizeof(mb_disc_private));
+
+	if (!mb_disc_get_file_offsets(disc, count, paths, offsets))
 		return 0;
-	}
-	disc_length = offsets[0];
-	if (disc_length > MAX_DISC_LENGTH) {
-		sprintf(disc->error_msg, "Disc too long");
+
+	return discid_put(d, 1, count, offsets);
+}
+
+int discid_put(DiscId *d, int first, int last, int *offsets) {
+	const char *error_msg;
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+
+	/* Necessary, because the disc handle could have been used before. */
+	mb_disc_join_background(disc);
+	memset(disc, 0, sizeof(mb_disc_private));
+
+	/* extensive checking of given parameters */
+	error_msg = mb_disc_check_toc(first, last, offsets);
+	if (error_msg != NULL) {
+		sprintf(disc->error_msg, "%s", error_msg);
 		return 0;
 	}
-	for (i = 0; i <= last; i++) {
-		if (offsets[i] > disc_length) {
-			sprintf(disc->error_msg, "Invalid offset");
-			return 0;
-		}
-		if (i > 1 && offsets[i-1] > offsets[i]) {
-			sprintf(disc->error_msg, "Invalid order");
-			return 0;
-		}
-	}
 
 	disc->first_track_num = first;
 	disc->last_track_num = last;
 
 	memcpy(disc->track_offsets, offsets, sizeof(int) * (last+1));
+	create_toc(disc);
 
 	disc->success = 1;
 
+	create_derived_values(disc);
+
 	return 1;
 }
 
+size_t discid_get_variants(DiscId *d, int range,
+			   discid_variant variants[], size_t max_variants) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	const int *offsets;
+	int first, last;
+	size_t count;
+
+	assert(disc != NULL);
+	assert(variants != NULL || max_variants == 0);
+
+	if (!disc->success || range < 0)
+		return 0;
+
+	first = disc->first_track_num;
+	last = disc->last_track_num;
+	offsets = disc->track_offsets;
+
+	count = add_variants(first, last, offsets, offsets[0], range,
+			     variants, 0, max_variants);
+	if (last > first) {
+		/* the last track was a data track in a second session */
+		count = add_variants(first, last - 1, offsets,
+				     offsets[last] - XA_INTERVAL, range,
+				     variants, count, max_variants);
+		/* the last track was a data track in the same session */
+		count = add_variants(first, last - 1, offsets, offsets[last],
+				     range, variants, count, max_variants);
+	}
+
+	return count;
+}
+
+char *discid_get_full_id(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+
+	if (!disc->success)
+		return NULL;
+
+	return disc->full_id;
+}
+
+char *discid_get_full_freedb_id(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+
+	if (!disc->success)
+		return NULL;
+
+	return disc->full_freedb_id;
+}
+
+int discid_get_full_toc(DiscId *d, discid_toc *toc) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(toc != NULL);
+
+	if (!disc->success)
+		return 0;
+
+	toc->first = disc->toc.first_track_num;
+	toc->last = get_full_offsets(disc, toc->offsets);
+
+	return 1;
+}
+
+int discid_get_track_control(DiscId *d, int i) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+	assert(FULL_TRACK_NUM_IS_VALID(disc, i));
+
+	if (!disc->success || !FULL_TRACK_NUM_IS_VALID(disc, i))
+		return -1;
+	else
+		return disc->toc.tracks[i].control;
+}
+
 
 char *discid_get_default_device(void) {
-	return mb_disc_get_default_device_unportable();
+	static THREAD_LOCAL char default_device[MB_DEVICE_NAME_LENGTH];
+
+	mb_disc_get_default_device_unportable(default_device,
+					      sizeof default_device);
+	return default_device;
+}
+
+int discid_get_default_device_r(char *device, int device_length) {
+	assert(device != NULL);
+	assert(device_length > 0);
+
+	return mb_disc_get_default_device_unportable(device, device_length);
 }
 
 int discid_get_first_track_num(DiscId *d) {
@@ -316,6 +567,34 @@ char* discid_get_track_isrc(DiscId *d, int i) {
 		return disc->isrc[i];
 }
 
+char *discid_get_cdtext(DiscId *d, int i, enum discid_cdtext_field field) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+	assert(i == 0 || TRACK_NUM_IS_VALID(disc, i));
+	assert(field >= 0 && field < MB_CDTEXT_FIELDS);
+
+	if (!disc->success || (i != 0 && !TRACK_NUM_IS_VALID(disc, i))
+			|| field < 0 || field >= MB_CDTEXT_FIELDS)
+		return NULL;
+	else
+		return disc->cdtext_pool + disc->cdtext[i][field];
+}
+
+int discid_get_track_pregap(DiscId *d, int i) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+	assert(disc->success);
+	assert(TRACK_NUM_IS_VALID(disc, i));
+
+	if (!disc->success || !TRACK_NUM_IS_VALID(disc, i))
+		return -1;
+	else if (i == disc->first_track_num)
+		return disc->track_offsets[i] - 150;
+	else
+		return disc->track_pregaps[i];
+}
+
 int discid_has_feature(enum discid_feature feature) {
 	return mb_disc_has_feature_unportable(feature);
 }
@@ -336,6 +615,12 @@ void discid_get_feature_list(char *features[DISCID_FEATURE_LENGTH]) {
 	if (discid_has_feature(DISCID_FEATURE_ISRC)) {
 		features[i++] = DISCID_FEATURE_STR_ISRC;
 	}
+	if (discid_has_feature(DISCID_FEATURE_CDTEXT)) {
+		features[i++] = DISCID_FEATURE_STR_CDTEXT;
+	}
+	if (discid_has_feature(DISCID_FEATURE_PREGAP)) {
+		features[i++] = DISCID_FEATURE_STR_PREGAP;
+	}
 
 	return;
 }
@@ -352,98 +637,211 @@ char *discid_get_version_string(void) {
 
 /****************************************************************************
  *
- * Private utilities, not exported.
+ * Internal functions, shared with other parts of the library.
  *
  ****************************************************************************/
 
-/*
- * Create a DiscID based on the TOC data found in the DiscId object.
- * The DiscID is placed in the provided string buffer.
- */
-static void create_disc_id(mb_disc_private *d, char buf[]) {
-	SHA_INFO	sha;
-	unsigned char	digest[20], *base64;
-	unsigned long	size;
-	char		tmp[17]; /* for 8 hex digits (16 to avoid trouble) */
-	int		i;
+const char *mb_disc_check_toc(int first, int last, const int offsets[]) {
+	int i, disc_length;
 
-	assert(d != NULL);
-	assert(d->success);
+	if (first > last || first < 1
+			|| first > 99 || last < 1 || last > 99) {
 
-	sha_init(&sha);
+		return "Illegal track limits";
+	}
+	if (offsets == NULL) {
+		return "No offsets given";
+	}
+	disc_length = offsets[0];
+	if (disc_length > MAX_DISC_LENGTH) {
+		return "Disc too long";
+	}
+	for (i = 0; i <= last; i++) {
+		if (offsets[i] > disc_length) {
+			return "Invalid offset";
+		}
+		if (i > 1 && offsets[i-1] > offsets[i]) {
+			return "Invalid order";
+		}
+	}
 
-	sprintf(tmp, "%02X", d->first_track_num);
-	sha_update(&sha, (unsigned char *) tmp, strlen(tmp));
+	return NULL;
+}
 
-	sprintf(tmp, "%02X", d->last_track_num);
-	sha_update(&sha, (unsigned char *) tmp, strlen(tmp));
+/* Write value as upper case hex number with the given number of digits. */
+static char *put_hex(char *buf, unsigned int value, int digits) {
+	static const char hex_digits[] = "0123456789ABCDEF";
+	int i;
 
-	for (i = 0; i < 100; i++) {
-		sprintf(tmp, "%08X", d->track_offsets[i]);
-		sha_update(&sha, (unsigned char *) tmp, strlen(tmp));
+	for (i = digits - 1; i >= 0; i--) {
+		buf[i] = hex_digits[value & 0xf];
+		value >>= 4;
 	}
+	return buf + digits;
+}
 
-	sha_final(digest, &sha);
+/*
+ * The SHA-1 input is the first and last track number as 2 hex digits
+ * and 100 offsets (lead-out first) as 8 hex digits each.
+ * Offsets after the last track are 0.
+ *
+ * The message is built in one buffer and hashed with a single update,
+ * which is a lot faster than printf and an update per number.
+ */
+static void create_digest_message(int first, int last, const int offsets[],
+				  char message[MB_DIGEST_MESSAGE_LENGTH]) {
+	char	*p;
+	int	i;
 
-	base64 = rfc822_binary(digest, sizeof(digest), &size);
+	p = put_hex(message, first, 2);
+	p = put_hex(p, last, 2);
+	for (i = 0; i <= last; i++) {
+		p = put_hex(p, offsets[i], 8);
+	}
+	memset(p, '0', message + MB_DIGEST_MESSAGE_LENGTH - p);
+}
 
-	memcpy(buf, base64, size);
-	buf[size] = '\0';
+static void hash_digest_message(char message[MB_DIGEST_MESSAGE_LENGTH],
+				unsigned char digest[]) {
+	SHA_INFO	sha;
 
-	free(base64);
+	sha_init(&sha);
+	sha_update(&sha, (unsigned char *) message, MB_DIGEST_MESSAGE_LENGTH);
+	sha_final(digest, &sha);
 }
 
+void mb_disc_create_digest(int first, int last, const int offsets[],
+			   unsigned char digest[]) {
+	char	message[MB_DIGEST_MESSAGE_LENGTH];
+
+	assert(offsets != NULL);
+
+	create_digest_message(first, last, offsets, message);
+	hash_digest_message(message, digest);
+}
 
 /*
- * Create a FreeDB DiscID based on the TOC data found in the DiscId object.
- * The DiscID is placed in the provided string buffer.
+ * The lead-out is in the first SHA-1 block of the message, so there is
+ * no common prefix to share between the variants. What can be shared is
+ * the message: it is built once per track count and only the 8 hex
+ * digits of the lead-out are replaced for every variant.
  */
-static void create_freedb_disc_id(mb_disc_private *d, char buf[]) {
+static size_t add_variants(int first, int last, const int offsets[],
+			   int leadout, int range, discid_variant variants[],
+			   size_t count, size_t max_variants) {
+	char	message[MB_DIGEST_MESSAGE_LENGTH];
+	discid_variant *variant;
+	int	delta;
+
+	create_digest_message(first, last, offsets, message);
+	for (delta = -range; delta <= range && count < max_variants;
+	     delta++) {
+		if (leadout + delta <= offsets[last])
+			continue;
+		variant = &variants[count++];
+		variant->last = last;
+		variant->leadout = leadout + delta;
+		put_hex(message + 4, (unsigned int) variant->leadout, 8);
+		hash_digest_message(message, variant->digest);
+		mb_base64_encode_digest(variant->digest, variant->id);
+	}
+
+	return count;
+}
+
+void mb_disc_create_freedb_id(int last, const int offsets[], char buf[]) {
 	int i, n, m, t;
 
-	assert(d != NULL);
-	assert(d->success);
+	assert(offsets != NULL);
 
 	n = 0;
-	for (i = 0; i < d->last_track_num; i++) {
-		m = d->track_offsets[i + 1] / 75;
+	for (i = 0; i < last; i++) {
+		m = offsets[i + 1] / 75;
 		while (m > 0) {
 			n += m % 10;
 			m /= 10;
 		}
 	}
-	t = d->track_offsets[0] / 75 - d->track_offsets[1] / 75;
-	sprintf(buf, "%08x", ((n % 0xff) << 24 | t << 8 | d->last_track_num));
+	t = offsets[0] / 75 - offsets[1] / 75;
+	sprintf(buf, "%08x", ((n % 0xff) << 24 | t << 8 | last));
+}
+
+void mb_disc_create_accuraterip_id(int first, int last, const int offsets[],
+				   const char freedb_id[], char buf[]) {
+	unsigned long id1, id2, lba;
+	int i;
+
+	assert(offsets != NULL);
+	assert(freedb_id != NULL);
+
+	/* AccurateRip uses sector addresses, without the 2 second lead-in.
+	 * The weights count the tracks from 1, whatever the first track
+	 * number is. A track at address 0 counts as 1 for the weighted sum. */
+	id1 = id2 = 0;
+	for (i = first; i <= last; i++) {
+		lba = (unsigned long) (offsets[i] - 150);
+		id1 += lba;
+		id2 += (lba > 0 ? lba : 1) * (i - first + 1);
+	}
+	lba = (unsigned long) (offsets[0] - 150);
+	id1 += lba;
+	id2 += lba * (last - first + 2);
+
+	sprintf(buf, "%03d-%08lx-%08lx-%s", last - first + 1,
+		id1 & 0xffffffffUL, id2 & 0xffffffffUL, freedb_id);
+}
+
+/*
+ * The CTDB hashes the offsets of the second to the last track and the
+ * lead-out relative to the first track, as 8 hex digits each, padded with
+ * '0' to 99 numbers, like CUETools does. The lead-out of the audio tracks
+ * is used, that's the end of the first session on discs with a data track.
+ */
+void mb_disc_create_ctdb_id(int first, int last, const int offsets[],
+			    char buf[]) {
+	char		message[99 * 8];
+	char		*p;
+	unsigned char	digest[DISCID_DIGEST_LENGTH];
+	SHA_INFO	sha;
+	int		i;
+
+	assert(offsets != NULL);
+
+	p = message;
+	for (i = first + 1; i <= last; i++) {
+		p = put_hex(p, offsets[i] - offsets[first], 8);
+	}
+	p = put_hex(p, offsets[0] - offsets[first], 8);
+	memset(p, '0', message + sizeof message - p);
+
+	sha_init(&sha);
+	sha_update(&sha, (unsigned char *) message, sizeof message);
+	sha_final(digest, &sha);
+	mb_base64_encode_digest(digest, buf);
 }
 
+
+
+/****************************************************************************
+ *
+ * Private utilities, not exported.
+ *
+ ****************************************************************************/
+
 /*
  * Create a string based on the TOC data found in the mb_disc_private
- * object. The returned string is allocated, caller has to free() it.
- * On failure, it returns NULL.
+ * object. The string is placed in the provided string buffer,
+ * which needs room for MB_TOC_STRING_LENGTH characters.
  *
  * Format is:
  * [1st track num][sep][last track num][sep][length in sectors][sep][1st track offset][sep]...
  */
-static char *create_toc_string(mb_disc_private *d, char *sep) {
-	char tmp[16];
-	char *toc;
-	int i, size;
+static void create_toc_string(mb_disc_private *d, char *sep, char buf[]) {
+	int i;
 
 	assert( d != NULL );
 
-	/* number of tracks */
-	size = 1 + d->last_track_num - d->first_track_num;
-	/* first&last track num and total length */
-	size += 3;
-	/* number + separator */
-	size *= (6 + strlen(sep));
-	/* nul */
-	size++;
-
-	toc = calloc(size, sizeof(char));
-	if (!toc) return NULL;
-
-	sprintf(toc, "%d%s%d%s%d",
+	buf += sprintf(buf, "%d%s%d%s%d",
 			d->first_track_num,
 			sep,
 			d->last_track_num,
@@ -451,21 +849,14 @@ static char *create_toc_string(mb_disc_private *d, char *sep) {
 			d->track_offsets[0]);
 
 	for (i = d->first_track_num; i <= d->last_track_num; i++) {
-		sprintf(tmp, "%s%d", sep, d->track_offsets[i]);
-		strcat(toc, tmp);
+		buf += sprintf(buf, "%s%d", sep, d->track_offsets[i]);
 	}
-
-	return toc;
 }
 
 /* Append &toc=... to buf, calling  create_toc_string() */
 static void cat_toc_param(mb_disc_private *d, char *buf) {
-	char *toc = create_toc_string(d, "+");
-	if (toc) {
-		strcat(buf, "&toc=");
-		strcat(buf, toc);
-		free(toc);
-	}
+	strcat(buf, "&toc=");
+	create_toc_string(d, "+", buf + strlen(buf));
 }
 
 /*
@@ -481,7 +872,7 @@ static void create_submission_url(mb_disc_private *d, char buf[]) {
 	strcpy(buf, MB_SUBMISSION_URL);
 
 	strcat(buf, "?id=");
-	strcat(buf, discid_get_id((DiscId *) d));
+	strcat(buf, d->id);
 
 	sprintf(tmp, "&tracks=%d", d->last_track_num);
 	strcat(buf, tmp);
@@ -500,9 +891,153 @@ static void create_webservice_url(mb_disc_private *d, char buf[]) {
 	strcpy(buf, MB_WEBSERVICE_URL);
 
 	strcat(buf, "?type=xml&discid=");
-	strcat(buf, discid_get_id((DiscId *) d));
+	strcat(buf, d->id);
 
 	cat_toc_param(d, buf);
 }
 
+/*
+ * Create all IDs, strings and URLs based on the TOC data found in the
+ * mb_disc_private object.
+ *
+ * This is done once after a successful read or put. The getters then only
+ * return the prepared buffers, so they never write to the object and
+ * a DiscId object can be shared between threads without locking.
+ */
+static void create_derived_values(mb_disc_private *d) {
+	assert(d != NULL);
+	assert(d->success);
+
+	if (!mb_disc_cache_lookup(d)) {
+		mb_disc_create_digest(d->first_track_num, d->last_track_num,
+				      d->track_offsets, d->digest);
+		mb_base64_encode_digest(d->digest, d->id);
+		mb_disc_create_freedb_id(d->last_track_num, d->track_offsets,
+					 d->freedb_id);
+		mb_disc_create_accuraterip_id(d->first_track_num,
+					      d->last_track_num,
+					      d->track_offsets, d->freedb_id,
+					      d->accuraterip_id);
+		mb_disc_create_ctdb_id(d->first_track_num, d->last_track_num,
+				       d->track_offsets, d->ctdb_id);
+		create_toc_string(d, " ", d->toc_string);
+		mb_disc_cache_store(d);
+	}
+	create_full_ids(d);
+	create_submission_url(d, d->submission_url);
+	create_webservice_url(d, d->webservice_url);
+}
+
+/*
+ * Create the TOC of d as it would be read from a disc without data tracks,
+ * for discs given by discid_put().
+ */
+static void create_toc(mb_disc_private *d) {
+	int i;
+
+	d->toc.first_track_num = d->first_track_num;
+	d->toc.last_track_num = d->last_track_num;
+	for (i = 0; i <= d->last_track_num; i++) {
+		d->toc.tracks[i].control = 0;
+		d->toc.tracks[i].address = d->track_offsets[i] - 150;
+	}
+}
+
+/*
+ * Get the offsets of all tracks of the TOC, including data tracks,
+ * with the rules of mb_disc_load_toc(). Returns the last track number.
+ */
+static int get_full_offsets(mb_disc_private *d, int offsets[]) {
+	int i;
+
+	memset(offsets, 0, sizeof(int) * 100);
+	for (i = d->toc.first_track_num; i <= d->toc.last_track_num; i++) {
+		if (d->toc.tracks[i].address > 0)
+			offsets[i] = d->toc.tracks[i].address + 150;
+		else
+			offsets[i] = 150;
+	}
+	offsets[0] = d->toc.tracks[0].address + 150;
+
+	return d->toc.last_track_num;
+}
+
+/*
+ * Create the IDs of the full TOC. They only differ from the other IDs
+ * for discs with data tracks, so usually nothing has to be hashed.
+ */
+static void create_full_ids(mb_disc_private *d) {
+	int offsets[100];
+	int last;
+
+	last = get_full_offsets(d, offsets);
+	if (last == d->last_track_num && offsets[0] == d->track_offsets[0]) {
+		memcpy(d->full_digest, d->digest, sizeof d->full_digest);
+		strcpy(d->full_id, d->id);
+		strcpy(d->full_freedb_id, d->freedb_id);
+		return;
+	}
+
+	mb_disc_create_digest(d->first_track_num, last, offsets,
+			      d->full_digest);
+	mb_base64_encode_digest(d->full_digest, d->full_id);
+	mb_disc_create_freedb_id(last, offsets, d->full_freedb_id);
+}
+
+/*
+ * Choose the tracks read by mb_disc_read_toc_summary_unportable()
+ * to recognize the TOC of d: the first, middle and last audio track
+ * and the last track of the disc, which can be a data track.
+ * Discs with the same length and number of tracks rarely have
+ * all of these at the same place. Returns the number of tracks.
+ */
+static int get_summary_tracks(mb_disc_private *d, int tracks[]) {
+	int count = 0;
+
+	tracks[count++] = d->first_track_num;
+	if (d->last_track_num > d->first_track_num + 1)
+		tracks[count++] = (d->first_track_num + d->last_track_num) / 2;
+	if (d->last_track_num > d->first_track_num)
+		tracks[count++] = d->last_track_num;
+	if (d->toc.last_track_num > d->last_track_num)
+		tracks[count++] = d->toc.last_track_num;
+
+	return count;
+}
+
+/*
+ * Compare the parts of a TOC read by mb_disc_read_toc_summary_unportable()
+ * for the given tracks with the full TOC of d.
+ */
+static int same_toc_summary(mb_disc_private *d, mb_disc_toc *toc,
+			    const int tracks[], int count) {
+	mb_disc_toc_track *track;
+	int i;
+
+	if (toc->first_track_num != d->toc.first_track_num
+		|| toc->last_track_num != d->toc.last_track_num
+		|| toc->tracks[0].address != d->toc.tracks[0].address)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		track = &d->toc.tracks[tracks[i]];
+		if (toc->tracks[tracks[i]].address != track->address
+			|| toc->tracks[tracks[i]].control != track->control)
+			return 0;
+	}
+	return 1;
+}
+
+int mb_disc_same_disc(mb_disc_private *disc, const char *device) {
+	mb_disc_toc toc;
+	int tracks[SUMMARY_TRACKS];
+	int count;
+
+	count = get_summary_tracks(disc, tracks);
+
+	return mb_disc_read_toc_summary_unportable(disc, device, &toc,
+						   tracks, count)
+		&& same_toc_summary(disc, &toc, tracks, count);
+}
+
 /* EOF */
@@ -108,6 +108,21 @@ int mb_disc_unix_read_toc_entry(int fd, int track_num, mb_disc_toc_track *track)
 	return 1;
 }
 
+int mb_disc_unix_has_audio(int fd) {
+	/* no quick check available, the TOC will tell */
+	return -1;
+}
+
+void mb_disc_unix_read_cdtext(int fd, mb_disc_private *disc) {
+	/* not implemented on this platform */
+	return;
+}
+
+void mb_disc_unix_read_pregaps(int fd, mb_disc_private *disc) {
+	/* not implemented on this platform */
+	return;
+}
+
 void mb_disc_unix_read_mcn(int fd, mb_disc_private *disc) {
 	struct cd_sub_channel_info sci;
 	struct ioc_read_subchannel rsc;
@@ -157,6 +172,12 @@ void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc, int track_num) {
 	}
 }
 
+int mb_disc_media_unchanged_unportable(const char *device, char key[],
+				       int key_length) {
+	/* media changes can't be detected here */
+	return -1;
+}
+
 int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	switch(feature) {
 		case DISCID_FEATURE_READ:
@@ -168,6 +189,40 @@ int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	}
 }
 
+int mb_disc_read_toc_summary_unportable(mb_disc_private *disc,
+					const char *device,
+					mb_disc_toc *toc,
+					const int tracks[], int count) {
+	char device_name[MAX_DEV_LEN] = "";
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device(device_number, device_name, MAX_DEV_LEN))
+			return 0;
+		device = device_name;
+	}
+
+	return mb_disc_unix_read_toc_summary(disc, device, toc, tracks,
+					     count);
+}
+
+int mb_disc_read_features_unportable(mb_disc_private *disc,
+				     const char *device,
+				     unsigned int features) {
+	char device_name[MAX_DEV_LEN] = "";
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device(device_number, device_name, MAX_DEV_LEN))
+			return 0;
+		device = device_name;
+	}
+
+	return mb_disc_unix_read_features(disc, device, features);
+}
+
 int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 			    unsigned int features) {
 	char device_name[MAX_DEV_LEN] = "";
@@ -188,11 +243,11 @@ int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 	return mb_disc_unix_read(disc, device, features);
 }
 
-char *mb_disc_get_default_device_unportable(void) {
-	static char result[MAX_DEV_LEN + 1];
+int mb_disc_get_default_device_unportable(char *device, int device_length) {
+	char result[MAX_DEV_LEN + 1];
 	/* No error check here, so we always return the appropriate device for cd0 */
 	get_device(1, result, sizeof result);
-	return result;
+	return snprintf(device, device_length, "%s", result) < device_length;
 }
 
 /* EOF */
@@ -119,6 +119,21 @@ static int get_device_from_number(int device_number,
 	return return_value;
 }
 
+int mb_disc_unix_has_audio(int fd) {
+	/* no quick check available, the TOC will tell */
+	return -1;
+}
+
+void mb_disc_unix_read_cdtext(int fd, mb_disc_private *disc) {
+	/* not implemented on this platform */
+	return;
+}
+
+void mb_disc_unix_read_pregaps(int fd, mb_disc_private *disc) {
+	/* not implemented on this platform */
+	return;
+}
+
 void mb_disc_unix_read_mcn(int fd, mb_disc_private *disc)
 {
     dk_cd_read_mcn_t cd_read_mcn;
@@ -147,6 +162,12 @@ void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc, int track)
     }
 }
 
+int mb_disc_media_unchanged_unportable(const char *device, char key[],
+				       int key_length) {
+	/* media changes can't be detected here */
+	return -1;
+}
+
 int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	switch(feature) {
 		case DISCID_FEATURE_READ:
@@ -158,9 +179,10 @@ int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	}
 }
 
-char *mb_disc_get_default_device_unportable(void)
+int mb_disc_get_default_device_unportable(char *device, int device_length)
 {
-	return MB_DEFAULT_DEVICE;
+	return snprintf(device, device_length, "%s", MB_DEFAULT_DEVICE)
+		< device_length;
 }
 
 int mb_disc_unix_read_toc_header(int fd, mb_disc_toc *mb_toc) {
@@ -226,6 +248,42 @@ int mb_disc_unix_read_toc_entry(int fd, int track_num, mb_disc_toc_track *toc) {
 	return 1;
 }
 
+int mb_disc_read_toc_summary_unportable(mb_disc_private *disc,
+					const char *device,
+					mb_disc_toc *toc,
+					const int tracks[], int count) {
+	char device_name[MAXPATHLEN] = "";
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device_from_number(device_number,
+					    device_name, MAXPATHLEN))
+			return 0;
+		device = device_name;
+	}
+
+	return mb_disc_unix_read_toc_summary(disc, device, toc, tracks,
+					     count);
+}
+
+int mb_disc_read_features_unportable(mb_disc_private *disc,
+				     const char *device,
+				     unsigned int features) {
+	char device_name[MAXPATHLEN] = "";
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device_from_number(device_number,
+					    device_name, MAXPATHLEN))
+			return 0;
+		device = device_name;
+	}
+
+	return mb_disc_unix_read_features(disc, device, features);
+}
+
 int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 			    unsigned int features) {
 	int device_number;
@@ -25,15 +25,37 @@
 #include "discid/discid_private.h"
 
 
-char *mb_disc_get_default_device_unportable(void) {
-	return "/dev/null";
+int mb_disc_get_default_device_unportable(char *device, int device_length) {
+	return snprintf(device, device_length, "%s", "/dev/null")
+		< device_length;
 }
 
 
+int mb_disc_media_unchanged_unportable(const char *device, char key[],
+				       int key_length) {
+	/* media changes can't be detected here */
+	return -1;
+}
+
 int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	return 0;
 }
 
+int mb_disc_read_toc_summary_unportable(mb_disc_private *disc,
+					const char *device,
+					mb_disc_toc *toc,
+					const int tracks[], int count) {
+	return 0;
+}
+
+int mb_disc_read_features_unportable(mb_disc_private *disc,
+				     const char *device,
+				     unsigned int features) {
+	snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
+		"disc reading not implemented on this platform");
+	return 0;
+}
+
 int mb_disc_read_unportable(mb_disc_private *disc, const char *device, unsigned int features) {
 	snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
 		"disc reading not implemented on this platform");
@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -51,13 +52,9 @@
 #define MB_DEFAULT_DEVICE "/dev/cdrom"
 #define MAX_DEV_LEN 50
 
-#if (defined(__GNUC__) && (__GNUC__ >= 4)) || defined(__clang__)
-#	define THREAD_LOCAL __thread
-#else
-#	define THREAD_LOCAL
-#endif
-
-static THREAD_LOCAL char default_device[MAX_DEV_LEN] = "";
+/* changes with every boot, media changes while powered off aren't noticed */
+#define BOOT_ID_FILE "/proc/sys/kernel/random/boot_id"
+#define BOOT_ID_LEN 36
 
 
 static int get_device(int number, char *device, int device_len) {
@@ -144,17 +141,17 @@ int mb_disc_unix_read_toc_entry(int fd, int track_num, mb_disc_toc_track *track)
 	return 1;
 }
 
-char *mb_disc_get_default_device_unportable(void) {
+int mb_disc_get_default_device_unportable(char *device, int device_length) {
+	char device_name[MAX_DEV_LEN] = "";
+
 	/* prefer the default device symlink to the internal names */
-	if (mb_disc_unix_exists(MB_DEFAULT_DEVICE)) {
-		return MB_DEFAULT_DEVICE;
-	} else {
-		if (get_device(1, default_device, MAX_DEV_LEN)) {
-			return default_device;
-		} else {
-			return MB_DEFAULT_DEVICE;
-		}
+	if (mb_disc_unix_exists(MB_DEFAULT_DEVICE)
+			|| !get_device(1, device_name, MAX_DEV_LEN)) {
+		strcpy(device_name, MB_DEFAULT_DEVICE);
 	}
+
+	return snprintf(device, device_length, "%s", device_name)
+		< device_length;
 }
 
 void mb_disc_unix_read_mcn(int fd, mb_disc_private *disc) {
@@ -198,6 +195,58 @@ static int scsi_cmd(int fd, unsigned char *cmd, int cmd_len,
 	}
 }
 
+int mb_disc_unix_has_audio(int fd) {
+	unsigned char cmd[10];
+	unsigned char data[4 + 100*8];
+	int profile, length, tracks, i;
+
+	memset(cmd, 0, sizeof cmd);
+	memset(data, 0, sizeof data);
+
+	cmd[0] = 0x46;		/* GET CONFIGURATION */
+	cmd[1] = 0x02;		/* only the starting feature */
+	/* cmd[2:3] = starting feature 0 (profile list) */
+	cmd[8] = 8;		/* only the header with the current profile */
+
+	if (scsi_cmd(fd, cmd, sizeof cmd, data, 8) != 0)
+		return -1;
+
+	profile = data[6] << 8 | data[7];
+	/* 0x10 - 0x5F are DVD, HD DVD and BD profiles, which can't have
+	 * audio tracks. 0x08 - 0x0A are CD profiles. Anything else, like
+	 * 0 (unknown), 0xFFFF or vendor profiles, is left to the TOC. */
+	if (profile >= 0x10 && profile <= 0x5F)
+		return 0;
+	if (profile < 0x08 || profile > 0x0A)
+		return -1;
+
+	memset(cmd, 0, sizeof cmd);
+	cmd[0] = 0x43;		/* READ TOC/PMA/ATIP */
+	/* cmd[1] = 0: LBA addresses, cmd[2] = 0: format 0 (TOC) */
+	cmd[6] = 1;		/* starting track */
+	cmd[7] = sizeof data >> 8;
+	cmd[8] = sizeof data & 0xff;
+
+	/* all TOC entries with their control bits in one command */
+	if (scsi_cmd(fd, cmd, sizeof cmd, data, sizeof data) != 0)
+		return -1;
+
+	/* data[0:1] = TOC data length, without the length field itself */
+	length = data[0] << 8 | data[1];
+	tracks = 0;
+	for (i = 4; i + 8 <= length + 2 && i + 8 <= (int) sizeof data; i += 8) {
+		/* data[i+1] = ADR and CONTROL, data[i+2] = track number */
+		if (data[i+2] == 0xAA)
+			continue;
+		if (!(data[i+1] & DATA_TRACK))
+			return 1;
+		tracks++;
+	}
+
+	/* without any entries the regular TOC reading reports the error */
+	return tracks > 0 ? 0 : -1;
+}
+
 void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc, int track_num) {
 	int i;
 	unsigned char cmd[10];
@@ -240,17 +289,172 @@ void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc, int track_num) {
 	/* data[21:23] = zero, AFRAME, reserved */
 }
 
+void mb_disc_unix_read_cdtext(int fd, mb_disc_private *disc) {
+	unsigned char cmd[10];
+	/* 4 header bytes and up to 8 blocks of 256 packs */
+	unsigned char *data;
+	int data_len = 4 + 8 * 256 * MB_CDTEXT_PACK_SIZE;
+	int length;
+
+	data = calloc(1, data_len);
+	if (data == NULL)
+		return;
+
+	memset(cmd, 0, sizeof cmd);
+	cmd[0] = 0x43;		/* READ TOC/PMA/ATIP */
+	cmd[2] = 0x05;		/* format 5: CD-TEXT from the lead-in */
+	cmd[7] = data_len >> 8;
+	cmd[8] = data_len & 0xff;
+
+	/* all packs in one command, drives without CD-TEXT fail or
+	 * return only the header */
+	if (scsi_cmd(fd, cmd, sizeof cmd, data, data_len) == 0) {
+		/* data[0:1] = data length, without the length field itself */
+		length = (data[0] << 8 | data[1]) - 2;
+		if (length > data_len - 4)
+			length = data_len - 4;
+		if (length > 0)
+			mb_disc_load_cdtext(disc, data + 4,
+					    length / MB_CDTEXT_PACK_SIZE);
+	}
+
+	free(data);
+}
+
+static int from_bcd(unsigned char value) {
+	return (value >> 4) * 10 + (value & 0x0f);
+}
+
+/* The mb_disc_q_reader for the drive, data points to the fd */
+static int read_q_track(void *fd_ptr, int lba, int *track_num) {
+	int fd = *(int *) fd_ptr;
+	unsigned char cmd[12];
+	unsigned char data[16];
+
+	memset(cmd, 0, sizeof cmd);
+	memset(data, 0, sizeof data);
+
+	cmd[0] = 0xBE;		/* READ CD */
+	cmd[1] = 1 << 2;	/* expected sector type: CD-DA */
+	cmd[2] = (lba >> 24) & 0xff;
+	cmd[3] = (lba >> 16) & 0xff;
+	cmd[4] = (lba >> 8) & 0xff;
+	cmd[5] = lba & 0xff;
+	cmd[8] = 1;		/* one sector */
+	/* cmd[9] = 0: no main channel data */
+	cmd[10] = 0x02;		/* formatted Q sub-channel, 16 bytes */
+
+	if (scsi_cmd(fd, cmd, sizeof cmd, data, sizeof data) != 0)
+		return -1;
+
+	/* data[0] = CONTROL and ADR, ADR 1 is the position */
+	if ((data[0] & 0x0f) != 1)
+		return 0;
+
+	/* data[1] = track number, data[2] = index, both BCD */
+	*track_num = from_bcd(data[1]);
+	return 1;
+}
+
+void mb_disc_unix_read_pregaps(int fd, mb_disc_private *disc) {
+	mb_disc_find_pregaps(disc, read_q_track, &fd);
+}
+
+int mb_disc_media_unchanged_unportable(const char *device, char key[],
+				       int key_length) {
+	char device_name[MAX_DEV_LEN] = "";
+	char boot_id[BOOT_ID_LEN+1] = "";
+	struct stat st;
+	FILE *boot_id_file;
+	int device_number, fd, changed, status;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device(device_number, device_name, MAX_DEV_LEN))
+			return -1;
+		device = device_name;
+	}
+
+	boot_id_file = fopen(BOOT_ID_FILE, "r");
+	if (boot_id_file == NULL)
+		return -1;
+	status = fscanf(boot_id_file, "%36s", boot_id);
+	fclose(boot_id_file);
+	if (status != 1)
+		return -1;
+
+	fd = open(device, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) != 0 || !S_ISBLK(st.st_mode)) {
+		close(fd);
+		return -1;
+	}
+
+	/* The kernel keeps a media changed flag for the ioctl interface,
+	 * which is set by every media change the drive reports
+	 * (GET EVENT STATUS NOTIFICATION) and reset by this query. */
+	changed = ioctl(fd, CDROM_MEDIA_CHANGED, CDSL_CURRENT);
+	status = ioctl(fd, CDROM_DRIVE_STATUS, CDSL_CURRENT);
+	close(fd);
+
+	if (changed < 0)
+		return -1;
+
+	if (snprintf(key, key_length, "%lx-%s",
+		     (unsigned long) st.st_rdev, boot_id) >= key_length)
+		return -1;
+
+	return changed == 0 && status == CDS_DISC_OK;
+}
+
 int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	switch(feature) {
 		case DISCID_FEATURE_READ:
 		case DISCID_FEATURE_MCN:
 		case DISCID_FEATURE_ISRC:
+		case DISCID_FEATURE_CDTEXT:
+		case DISCID_FEATURE_PREGAP:
 			return 1;
 		default:
 			return 0;
 	}
 }
 
+int mb_disc_read_toc_summary_unportable(mb_disc_private *disc,
+					const char *device,
+					mb_disc_toc *toc,
+					const int tracks[], int count) {
+	char device_name[MAX_DEV_LEN] = "";
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device(device_number, device_name, MAX_DEV_LEN))
+			return 0;
+		device = device_name;
+	}
+
+	return mb_disc_unix_read_toc_summary(disc, device, toc, tracks,
+					     count);
+}
+
+int mb_disc_read_features_unportable(mb_disc_private *disc,
+				     const char *device,
+				     unsigned int features) {
+	char device_name[MAX_DEV_LEN] = "";
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_device(device_number, device_name, MAX_DEV_LEN))
+			return 0;
+		device = device_name;
+	}
+
+	return mb_disc_unix_read_features(disc, device, features);
+}
+
 int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 			    unsigned int features) {
 	char device_name[MAX_DEV_LEN] = "";
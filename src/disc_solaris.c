@@ -78,6 +78,21 @@ int mb_disc_unix_read_toc_entry(int fd, int track_num, mb_disc_toc_track *track)
 	return 1;
 }
 
+int mb_disc_unix_has_audio(int fd) {
+	/* no quick check available, the TOC will tell */
+	return -1;
+}
+
+void mb_disc_unix_read_cdtext(int fd, mb_disc_private *disc) {
+	/* not implemented on this platform */
+	return;
+}
+
+void mb_disc_unix_read_pregaps(int fd, mb_disc_private *disc) {
+	/* not implemented on this platform */
+	return;
+}
+
 void mb_disc_unix_read_mcn(int fd, mb_disc_private *disc) {
 	return;
 }
@@ -86,8 +101,17 @@ void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc, int track_num) {
 	return;
 }
 
-char *mb_disc_get_default_device_unportable(void) {
-	return mb_disc_unix_find_device(device_candidates, NUM_CANDIDATES);
+int mb_disc_get_default_device_unportable(char *device, int device_length) {
+	return snprintf(device, device_length, "%s",
+			mb_disc_unix_find_device(device_candidates,
+						 NUM_CANDIDATES))
+		< device_length;
+}
+
+int mb_disc_media_unchanged_unportable(const char *device, char key[],
+				       int key_length) {
+	/* media changes can't be detected here */
+	return -1;
 }
 
 int mb_disc_has_feature_unportable(enum discid_feature feature) {
@@ -99,6 +123,20 @@ int mb_disc_has_feature_unportable(enum discid_feature feature) {
 	}
 }
 
+int mb_disc_read_toc_summary_unportable(mb_disc_private *disc,
+					const char *device,
+					mb_disc_toc *toc,
+					const int tracks[], int count) {
+	return mb_disc_unix_read_toc_summary(disc, device, toc, tracks,
+					     count);
+}
+
+int mb_disc_read_features_unportable(mb_disc_private *disc,
+				     const char *device,
+				     unsigned int features) {
+	return mb_disc_unix_read_features(disc, device, features);
+}
+
 int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 			    unsigned int features) {
 	return mb_disc_unix_read(disc, device, features);
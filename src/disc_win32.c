@@ -46,16 +46,6 @@
 #define MB_DEFAULT_DEVICE	"D:"
 #define MAX_DEV_LEN 3
 
-#if defined(_MSC_VER)
-#	define THREAD_LOCAL __declspec(thread)
-#elif (defined(__GNUC__) && (__GNUC__ >= 4)) || defined(__clang__)
-#	define THREAD_LOCAL __thread
-#else
-#	define THREAD_LOCAL
-#endif
-
-static THREAD_LOCAL char default_device[MAX_DEV_LEN] = "\0";
-
 static int address_to_sectors(UCHAR address[4]) {
 	return address[1] * 4500 + address[2] * 75 + address[3];
 }
@@ -147,12 +137,21 @@ static int get_nth_device(int number, char* device, int device_length) {
 	return FALSE;
 }
 
-char *mb_disc_get_default_device_unportable(void) {
-	if (!get_nth_device(1, default_device, MAX_DEV_LEN)) {
-		return MB_DEFAULT_DEVICE;
+int mb_disc_get_default_device_unportable(char *device, int device_length) {
+	char device_name[MAX_DEV_LEN] = "";
+
+	if (!get_nth_device(1, device_name, MAX_DEV_LEN)) {
+		strcpy(device_name, MB_DEFAULT_DEVICE);
 	}
 
-	return default_device;
+	return snprintf(device, device_length, "%s", device_name)
+		< device_length;
+}
+
+int mb_disc_media_unchanged_unportable(const char *device, char key[],
+				       int key_length) {
+	/* media changes can't be detected here */
+	return -1;
 }
 
 int mb_disc_has_feature_unportable(enum discid_feature feature) {
@@ -198,12 +197,54 @@ static int mb_disc_winnt_read_toc(HANDLE device, mb_disc_private *disc, mb_disc_
 	return 1;
 }
 
+/* Read everything but the TOC, which has to be loaded already */
+static void read_features(HANDLE hDevice, mb_disc_private *disc,
+			  unsigned int features) {
+	int i;
+
+	if (features & DISCID_FEATURE_MCN) {
+		read_disc_mcn(hDevice, disc);
+	}
+
+	for (i = disc->first_track_num; i <= disc->last_track_num; i++) {
+		if (features & DISCID_FEATURE_ISRC) {
+			read_disc_isrc(hDevice, disc, i);
+		}
+	}
+}
+
+int mb_disc_read_toc_summary_unportable(mb_disc_private *disc,
+					const char *device,
+					mb_disc_toc *toc,
+					const int tracks[], int count) {
+	char tmpDevice[MAX_DEV_LEN];
+	HANDLE hDevice;
+	int device_number, ok;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_nth_device(device_number, tmpDevice, MAX_DEV_LEN))
+			return 0;
+		device = tmpDevice;
+	}
+
+	hDevice = create_device_handle(disc, device);
+	if (hDevice == 0)
+		return 0;
+
+	/* the whole TOC is a single command here */
+	ok = mb_disc_winnt_read_toc(hDevice, disc, toc);
+	CloseHandle(hDevice);
+
+	return ok;
+}
+
 int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 			    unsigned int features) {
 	mb_disc_toc toc;
 	char tmpDevice[MAX_DEV_LEN];
 	HANDLE hDevice;
-	int i, device_number;
+	int device_number;
 
 	device_number = (int) strtol(device, NULL, 10);
 
@@ -230,16 +271,32 @@ int mb_disc_read_unportable(mb_disc_private *disc, const char *device,
 		return 0;
 	}
 
-	if (features & DISCID_FEATURE_MCN) {
-		read_disc_mcn(hDevice, disc);
-	}
+	read_features(hDevice, disc, features);
 
-	for (i = disc->first_track_num; i <= disc->last_track_num; i++) {
-		if (features & DISCID_FEATURE_ISRC) {
-			read_disc_isrc(hDevice, disc, i);
-		}
+	CloseHandle(hDevice);
+	return 1;
+}
+
+int mb_disc_read_features_unportable(mb_disc_private *disc,
+				     const char *device,
+				     unsigned int features) {
+	char tmpDevice[MAX_DEV_LEN];
+	HANDLE hDevice;
+	int device_number;
+
+	device_number = (int) strtol(device, NULL, 10);
+	if (device_number > 0) {
+		if (!get_nth_device(device_number, tmpDevice, MAX_DEV_LEN))
+			return 0;
+		device = tmpDevice;
 	}
 
+	hDevice = create_device_handle(disc, device);
+	if (hDevice == 0)
+		return 0;
+
+	read_features(hDevice, disc, features);
+
 	CloseHandle(hDevice);
 	return 1;
 }
@@ -0,0 +1,254 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Index for finding TOCs with nearly the same track lengths.
+ *
+ * Comparing track lengths instead of offsets ignores a constant shift
+ * of the whole disc. Every TOC gets a key of its number of tracks,
+ * its total length and the length of its first track, both quantized
+ * to FUZZY_QUANTUM sectors. The entries are sorted by that key,
+ * so the candidates for a query are a few ranges found by binary search:
+ * one for every total length bucket within reach of the tolerance,
+ * restricted to the first track buckets within reach.
+ * The track lengths are kept in one pool, the entries only have
+ * their position in it.
+ */
+
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+/* sectors per bucket of the total and first track length */
+#define FUZZY_QUANTUM	75
+
+typedef struct {
+	int tracks;
+	int total;		/* quantized total length */
+	int first;		/* quantized length of the first track */
+	size_t lengths;		/* position of the track lengths in the pool */
+	size_t toc;		/* position in the TOCs given to build */
+} fuzzy_entry;
+
+struct discid_fuzzy {
+	fuzzy_entry *entries;
+	size_t count;
+	int *pool;
+};
+
+
+static int compare_keys(const fuzzy_entry *a, int tracks, int total,
+			int first) {
+	if (a->tracks != tracks)
+		return a->tracks < tracks ? -1 : 1;
+	if (a->total != total)
+		return a->total < total ? -1 : 1;
+	if (a->first != first)
+		return a->first < first ? -1 : 1;
+	return 0;
+}
+
+static int compare_entries(const void *a, const void *b) {
+	const fuzzy_entry *y = (const fuzzy_entry *) b;
+	int result;
+
+	result = compare_keys((const fuzzy_entry *) a, y->tracks, y->total,
+			      y->first);
+	if (result != 0 || ((const fuzzy_entry *) a)->toc == y->toc)
+		return result;
+	return ((const fuzzy_entry *) a)->toc < y->toc ? -1 : 1;
+}
+
+/* Write the track lengths, the last one ends at the lead-out */
+static void get_lengths(int first, int last, const int offsets[],
+			int lengths[]) {
+	int i;
+
+	for (i = first; i < last; i++) {
+		lengths[i - first] = offsets[i + 1] - offsets[i];
+	}
+	lengths[last - first] = offsets[0] - offsets[last];
+}
+
+discid_fuzzy *discid_fuzzy_build(const discid_toc *tocs, size_t count) {
+	discid_fuzzy *fuzzy;
+	const discid_toc *toc;
+	fuzzy_entry *entry;
+	size_t i, pool_size = 0;
+
+	assert(tocs != NULL || count == 0);
+
+	fuzzy = calloc(1, sizeof(discid_fuzzy));
+	if (fuzzy == NULL)
+		return NULL;
+
+	for (i = 0; i < count; i++) {
+		toc = &tocs[i];
+		if (mb_disc_check_toc(toc->first, toc->last, toc->offsets)
+				== NULL)
+			pool_size += toc->last - toc->first + 1;
+	}
+	fuzzy->entries = malloc((count > 0 ? count : 1) * sizeof(fuzzy_entry));
+	fuzzy->pool = malloc((pool_size > 0 ? pool_size : 1) * sizeof(int));
+	if (fuzzy->entries == NULL || fuzzy->pool == NULL) {
+		discid_fuzzy_free(fuzzy);
+		return NULL;
+	}
+
+	pool_size = 0;
+	for (i = 0; i < count; i++) {
+		toc = &tocs[i];
+		if (mb_disc_check_toc(toc->first, toc->last, toc->offsets)
+				!= NULL)
+			continue;
+		entry = &fuzzy->entries[fuzzy->count++];
+		entry->tracks = toc->last - toc->first + 1;
+		entry->total = (toc->offsets[0] - toc->offsets[toc->first])
+			/ FUZZY_QUANTUM;
+		entry->lengths = pool_size;
+		entry->toc = i;
+		get_lengths(toc->first, toc->last, toc->offsets,
+			    fuzzy->pool + pool_size);
+		entry->first = fuzzy->pool[pool_size] / FUZZY_QUANTUM;
+		pool_size += entry->tracks;
+	}
+
+	qsort(fuzzy->entries, fuzzy->count, sizeof(fuzzy_entry),
+	      compare_entries);
+
+	return fuzzy;
+}
+
+/* First entry with a key not below the given one */
+static size_t lower_bound(const discid_fuzzy *fuzzy, int tracks, int total,
+			  int first) {
+	size_t low = 0, high = fuzzy->count, middle;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (compare_keys(&fuzzy->entries[middle], tracks, total,
+				 first) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/* Insert a match, keeping the matches sorted by distance */
+static size_t add_match(discid_fuzzy_match matches[], size_t count,
+			size_t max_matches, const discid_fuzzy_match *match) {
+	size_t i;
+
+	if (count == max_matches) {
+		if (max_matches == 0
+		    || matches[count - 1].distance <= match->distance)
+			return count;
+		count--;
+	}
+	for (i = count; i > 0 && matches[i - 1].distance > match->distance;
+	     i--) {
+		matches[i] = matches[i - 1];
+	}
+	matches[i] = *match;
+
+	return count + 1;
+}
+
+size_t discid_fuzzy_lookup(const discid_fuzzy *fuzzy, DiscId *d,
+			   int tolerance, discid_fuzzy_match matches[],
+			   size_t max_matches) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	int lengths[100];
+	int tracks, total, total_q, first_lo, first_hi;
+	int i, deviation;
+	size_t pos, found = 0;
+	const fuzzy_entry *entry;
+	const int *other;
+	discid_fuzzy_match match;
+
+	assert(fuzzy != NULL);
+	assert(disc != NULL);
+	assert(matches != NULL || max_matches == 0);
+
+	if (!disc->success || tolerance < 0)
+		return 0;
+
+	tracks = disc->last_track_num - disc->first_track_num + 1;
+	get_lengths(disc->first_track_num, disc->last_track_num,
+		    disc->track_offsets, lengths);
+	total = disc->track_offsets[0]
+		- disc->track_offsets[disc->first_track_num];
+	first_lo = (lengths[0] - tolerance) / FUZZY_QUANTUM;
+	first_hi = (lengths[0] + tolerance) / FUZZY_QUANTUM;
+
+	/* the total can be off by the tolerance for every track */
+	for (total_q = (total - tracks * tolerance) / FUZZY_QUANTUM;
+	     total_q <= (total + tracks * tolerance) / FUZZY_QUANTUM;
+	     total_q++) {
+		pos = lower_bound(fuzzy, tracks, total_q, first_lo);
+		for (; pos < fuzzy->count; pos++) {
+			entry = &fuzzy->entries[pos];
+			if (compare_keys(entry, tracks, total_q, first_hi) > 0)
+				break;
+
+			other = fuzzy->pool + entry->lengths;
+			match.toc = entry->toc;
+			match.distance = 0;
+			match.max_deviation = 0;
+			for (i = 0; i < tracks; i++) {
+				deviation = abs(lengths[i] - other[i]);
+				if (deviation > tolerance)
+					break;
+				match.distance += deviation;
+				if (deviation > match.max_deviation)
+					match.max_deviation = deviation;
+			}
+			if (i == tracks)
+				found = add_match(matches, found, max_matches,
+						  &match);
+		}
+	}
+
+	return found;
+}
+
+size_t discid_fuzzy_get_count(const discid_fuzzy *fuzzy) {
+	assert(fuzzy != NULL);
+
+	return fuzzy->count;
+}
+
+void discid_fuzzy_free(discid_fuzzy *fuzzy) {
+	if (fuzzy == NULL)
+		return;
+
+	free(fuzzy->entries);
+	free(fuzzy->pool);
+	free(fuzzy);
+}
+
+/* EOF */
@@ -0,0 +1,1312 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Reading the TOC from the description files of disc images:
+ * CUE sheets, cdrdao TOC files and CloneCD CCD files,
+ * from the CUESHEET metadata of FLAC files and from EAC and XLD logs.
+ * For rips with one file per track the TOC is put together
+ * from the lengths in the headers of the audio files.
+ *
+ * The files are parsed line by line with fixed buffers, nothing is
+ * allocated. The data files are not read, only their size is taken
+ * (and the header for WAVE files) when a track length isn't given.
+ * Audio files have to be CD audio, 44100 Hz with 2 channels of 16 bits.
+ * The resulting mb_disc_toc goes through mb_disc_load_toc(),
+ * like the TOC read from a drive.
+ */
+
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+	#if (_MSC_VER < 1900)
+		#define snprintf _snprintf
+	#endif
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+#ifdef _WIN32
+typedef __int64 file_size;
+typedef struct _stat64 file_stat;
+#define get_file_stat _stat64
+#else
+typedef off_t file_size;
+typedef struct stat file_stat;
+#define get_file_stat stat
+#endif
+
+#define LINE_LENGTH	1024
+#define PATH_LENGTH	4096
+
+/* bytes per sector of audio data */
+#define AUDIO_SECTOR_SIZE	2352
+/* bytes of the sub-channel data of raw images */
+#define SUBCHANNEL_SIZE		96
+
+/* returned for lengths of audio files that aren't CD audio */
+#define NOT_CD_AUDIO		-2
+#define NOT_CD_AUDIO_MSG	"not CD audio (44100 Hz, 2 channels, 16 bits)"
+
+
+/*
+ * Helpers
+ * -------
+ */
+
+/* Set the error message, long paths are cut at the start */
+static int image_error(mb_disc_private *disc, const char *path, int line_num,
+		       const char *msg) {
+	size_t length = strlen(path);
+
+	if (length > MB_ERROR_MSG_LENGTH / 2)
+		path += length - MB_ERROR_MSG_LENGTH / 2;
+	if (line_num > 0) {
+		snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
+			 "%.*s:%d: %s", MB_ERROR_MSG_LENGTH / 2, path,
+			 line_num, msg);
+	} else {
+		snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
+			 "%.*s: %s", MB_ERROR_MSG_LENGTH / 2, path, msg);
+	}
+	return 0;
+}
+
+static const char *skip_space(const char *s) {
+	while (*s != '\0' && isspace((unsigned char) *s))
+		s++;
+	return s;
+}
+
+/*
+ * Copy the next word into the buffer, which is either up to the next space
+ * or a "quoted string". Returns the rest of the line after the word
+ * or NULL if there is none.
+ */
+static const char *next_word(const char *s, char word[], int length) {
+	int i = 0;
+	char end;
+
+	s = skip_space(s);
+	if (*s == '\0')
+		return NULL;
+
+	if (*s == '"') {
+		end = '"';
+		s++;
+	} else {
+		end = ' ';
+	}
+	while (*s != '\0' && *s != end
+			&& !(end == ' ' && isspace((unsigned char) *s))) {
+		if (i < length - 1)
+			word[i++] = *s;
+		s++;
+	}
+	if (*s == '"')
+		s++;
+	word[i] = '\0';
+
+	return s;
+}
+
+/* Parse a time as mm:ss:ff in sectors. Returns -1 for other formats. */
+static int parse_msf(const char *s) {
+	int m, sec, f;
+	char rest;
+
+	if (sscanf(s, "%d:%d:%d%c", &m, &sec, &f, &rest) != 3
+			|| m < 0 || sec < 0 || sec >= 60 || f < 0 || f >= 75)
+		return -1;
+
+	return (m * 60 + sec) * 75 + f;
+}
+
+static int equal_nocase(const char *a, const char *b) {
+	while (*a != '\0' && toupper((unsigned char) *a)
+			== toupper((unsigned char) *b)) {
+		a++;
+		b++;
+	}
+	return *a == '\0' && *b == '\0';
+}
+
+static int has_extension(const char *path, const char *extension) {
+	size_t path_len = strlen(path);
+	size_t ext_len = strlen(extension);
+
+	return path_len > ext_len
+		&& equal_nocase(path + path_len - ext_len, extension);
+}
+
+/* File names in the sheets are relative to the directory of the sheet */
+static int resolve_path(const char *sheet, const char *name,
+			char path[], int length) {
+	const char *slash;
+	int dir_len;
+
+	slash = strrchr(sheet, '/');
+#ifdef _WIN32
+	if (strrchr(sheet, '\\') > slash)
+		slash = strrchr(sheet, '\\');
+	if (name[0] == '\\' || (name[0] != '\0' && name[1] == ':'))
+		slash = NULL;
+#endif
+	if (name[0] == '/' || slash == NULL) {
+		return snprintf(path, length, "%s", name) < length;
+	}
+
+	dir_len = (int) (slash - sheet) + 1;
+	return snprintf(path, length, "%.*s%s", dir_len, sheet, name) < length;
+}
+
+static file_size get_file_size(const char *path) {
+	file_stat st;
+
+	if (get_file_stat(path, &st) != 0)
+		return -1;
+	return st.st_size;
+}
+
+static int is_cd_audio(unsigned long rate, int channels, int bits) {
+	return rate == 44100 && channels == 2 && bits == 16;
+}
+
+static unsigned long get_le32(const unsigned char *p) {
+	return (unsigned long) p[0] | (unsigned long) p[1] << 8
+		| (unsigned long) p[2] << 16 | (unsigned long) p[3] << 24;
+}
+
+static int get_le16(const unsigned char *p) {
+	return p[0] | p[1] << 8;
+}
+
+/* PCM or WAVE_FORMAT_EXTENSIBLE */
+#define WAVE_FORMAT_PCM		0x0001
+#define WAVE_FORMAT_EXTENSIBLE	0xfffe
+
+/*
+ * Size of the audio data in a RIFF WAVE file, -1 on errors
+ * and NOT_CD_AUDIO when the fmt chunk has another format.
+ */
+static file_size get_wave_data_size(const char *path) {
+	unsigned char header[12];
+	unsigned char chunk[8];
+	unsigned char fmt[16];
+	unsigned long chunk_size, skip;
+	file_size size, offset;
+	int format, have_fmt = 0;
+	FILE *file;
+
+	size = get_file_size(path);
+	file = fopen(path, "rb");
+	if (size < 0 || file == NULL) {
+		if (file != NULL)
+			fclose(file);
+		return -1;
+	}
+
+	if (fread(header, 1, sizeof header, file) != sizeof header
+			|| memcmp(header, "RIFF", 4) != 0
+			|| memcmp(header + 8, "WAVE", 4) != 0) {
+		fclose(file);
+		return -1;
+	}
+
+	offset = sizeof header;
+	while (fread(chunk, 1, sizeof chunk, file) == sizeof chunk) {
+		offset += sizeof chunk;
+		chunk_size = get_le32(chunk + 4);
+		skip = chunk_size + (chunk_size & 1);
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (chunk_size < sizeof fmt
+					|| fread(fmt, 1, sizeof fmt, file)
+						!= sizeof fmt)
+				break;
+			format = get_le16(fmt);
+			if ((format != WAVE_FORMAT_PCM
+			     && format != WAVE_FORMAT_EXTENSIBLE)
+					|| !is_cd_audio(get_le32(fmt + 4),
+							get_le16(fmt + 2),
+							get_le16(fmt + 14))) {
+				fclose(file);
+				return NOT_CD_AUDIO;
+			}
+			have_fmt = 1;
+			skip -= sizeof fmt;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			fclose(file);
+			if (!have_fmt)
+				return -1;
+			/* streamed files don't always have the size set,
+			 * the chunk header was read, so offset <= size */
+			if (chunk_size == 0 || chunk_size == 0xffffffffUL
+				|| chunk_size > (unsigned long) (size - offset))
+				return size - offset;
+			return (file_size) chunk_size;
+		}
+		/* chunks are padded to an even size */
+		offset += chunk_size + (chunk_size & 1);
+		if (offset > size || fseek(file, (long) skip, SEEK_CUR) != 0)
+			break;
+	}
+	fclose(file);
+
+	return -1;
+}
+
+/* Number of sectors for the given number of bytes, partial sectors count */
+static int bytes_to_sectors(file_size bytes, int sector_size) {
+	return (int) ((bytes + sector_size - 1) / sector_size);
+}
+
+/*
+ * Number of audio sectors in a WAVE file or a raw audio file,
+ * -1 on errors or NOT_CD_AUDIO
+ */
+static int get_audio_sectors(const char *path, int wave) {
+	file_size size;
+
+	if (wave)
+		size = get_wave_data_size(path);
+	else
+		size = get_file_size(path);
+
+	if (size < 0)
+		return size == NOT_CD_AUDIO ? NOT_CD_AUDIO : -1;
+	return bytes_to_sectors(size, AUDIO_SECTOR_SIZE);
+}
+
+/* Read the next line, without a UTF-8 byte order mark at the start */
+static int read_line(FILE *file, char line[], int length, int *line_num) {
+	if (fgets(line, length, file) == NULL)
+		return 0;
+	if (++*line_num == 1 && memcmp(line, "\xef\xbb\xbf", 3) == 0)
+		memmove(line, line + 3, strlen(line + 3) + 1);
+	return 1;
+}
+
+static void set_mcn(mb_disc_private *disc, const char *mcn) {
+	if (strlen(mcn) == MCN_STR_LENGTH)
+		strcpy(disc->mcn, mcn);
+}
+
+static void set_isrc(mb_disc_private *disc, int track, const char *isrc) {
+	if (track >= 1 && track <= 99 && strlen(isrc) == ISRC_STR_LENGTH)
+		strcpy(disc->isrc[track], isrc);
+}
+
+/* Check that all tracks from first to last were found */
+static int check_tracks(mb_disc_private *disc, const char *path,
+			mb_disc_toc *toc, const int found[]) {
+	char msg[64];
+	int i;
+
+	if (toc->last_track_num < 1)
+		return image_error(disc, path, 0, "no tracks found");
+
+	for (i = toc->first_track_num; i <= toc->last_track_num; i++) {
+		if (!found[i]) {
+			sprintf(msg, "no start found for track %d", i);
+			return image_error(disc, path, 0, msg);
+		}
+	}
+	return 1;
+}
+
+/* Set the error for a failed length from one of the functions below */
+static int length_error(mb_disc_private *disc, const char *path,
+			int length) {
+	if (length == NOT_CD_AUDIO)
+		return image_error(disc, path, 0, NOT_CD_AUDIO_MSG);
+	return image_error(disc, path, 0, "cannot get the length");
+}
+
+
+/*
+ * CUE sheets
+ * ----------
+ *
+ * Every FILE starts where the previous one ended. Its length comes from
+ * the file size: for BINARY files the last track of the file gets what
+ * is left after the tracks before it, with the sector size of its mode.
+ * PREGAP and POSTGAP are not part of the files.
+ * "REM SESSION" starting a second session adds the gap between sessions,
+ * which mb_disc_load_toc() takes off again for the lead-out.
+ */
+
+typedef struct {
+	char file[PATH_LENGTH];
+	int wave;		/* the current file is a WAVE file */
+	int file_start;		/* sector where the current file starts */
+	int shift;		/* sectors not in any file up to this point */
+	int track;		/* current track, 0 before the first */
+	int track_abs;		/* start of the current track on the disc */
+	int track_in_file;	/* current track has data in the current file */
+	int track_start;	/* start of the current track in the file */
+	int sector_size;	/* sector size of the current track */
+	int prev_start;		/* start of the previous track in the file */
+	int prev_size;		/* sector size of the previous track */
+	file_size track_bytes;	/* bytes in the file before the track */
+	int new_session;	/* a session started before the current track */
+	int found[100];
+} cue_state;
+
+static int cue_sector_size(const char *mode) {
+	const char *slash = strchr(mode, '/');
+
+	if (equal_nocase(mode, "AUDIO"))
+		return AUDIO_SECTOR_SIZE;
+	if (equal_nocase(mode, "CDG"))
+		return AUDIO_SECTOR_SIZE + SUBCHANNEL_SIZE;
+	if (slash != NULL && atoi(slash + 1) > 0)
+		return atoi(slash + 1);
+	return -1;
+}
+
+/* Return the length of the current file in sectors, < 0 on errors */
+static int cue_file_sectors(cue_state *cue) {
+	file_size size;
+
+	if (cue->wave)
+		return get_audio_sectors(cue->file, 1);
+
+	size = get_file_size(cue->file);
+	if (size < cue->track_bytes)
+		return -1;
+	size -= cue->track_bytes;
+
+	/* the last track in the file gets the rest */
+	if (cue->track_in_file && cue->track_start >= 0)
+		return cue->track_start
+			+ bytes_to_sectors(size, cue->sector_size);
+	if (cue->prev_start >= 0)
+		return cue->prev_start
+			+ bytes_to_sectors(size, cue->prev_size);
+	return bytes_to_sectors(size, AUDIO_SECTOR_SIZE);
+}
+
+static void cue_file(cue_state *cue) {
+	cue->track_bytes = 0;
+	cue->prev_start = -1;
+	/* a track can be continued in the next file */
+	cue->track_in_file = cue->track > 0;
+	cue->track_start = cue->track_abs >= 0 ? 0 : -1;
+}
+
+static void cue_track(cue_state *cue, int track, int sector_size) {
+	cue->prev_start = cue->track_in_file ? cue->track_start : -1;
+	cue->prev_size = cue->sector_size;
+	cue->track = track;
+	cue->track_abs = -1;
+	cue->track_in_file = 1;
+	cue->track_start = -1;
+	cue->sector_size = sector_size;
+}
+
+static void cue_index(cue_state *cue, mb_disc_toc *toc, int index, int pos) {
+	int abs_pos = cue->file_start + pos + cue->shift;
+
+	/* the first index of a track ends the previous one */
+	if (cue->track_start < 0) {
+		cue->track_start = pos;
+		if (cue->prev_start >= 0) {
+			cue->track_bytes += (file_size) (pos - cue->prev_start)
+				* cue->prev_size;
+			cue->prev_start = -1;
+		}
+	}
+	if (cue->track_abs < 0)
+		cue->track_abs = abs_pos;
+	if (index != 1)
+		return;
+
+	if (cue->new_session) {
+		/* the gap between the sessions includes the track pregap */
+		cue->shift += XA_INTERVAL - (abs_pos - cue->track_abs);
+		abs_pos = cue->track_abs + XA_INTERVAL;
+		cue->new_session = 0;
+	}
+	toc->tracks[cue->track].address = abs_pos;
+	cue->found[cue->track] = 1;
+}
+
+static int read_cue(mb_disc_private *disc, FILE *file, const char *path,
+		    mb_disc_toc *toc) {
+	char line[LINE_LENGTH];
+	char word[PATH_LENGTH];
+	const char *rest;
+	cue_state cue;
+	int line_num = 0;
+	int number, index, pos, sectors, sector_size;
+
+	memset(&cue, 0, sizeof cue);
+	cue.track_abs = -1;
+	cue.track_start = -1;
+	cue.prev_start = -1;
+
+	while (read_line(file, line, sizeof line, &line_num)) {
+		rest = next_word(line, word, sizeof word);
+		if (rest == NULL)
+			continue;
+
+		if (equal_nocase(word, "FILE")) {
+			if (cue.file[0] != '\0') {
+				sectors = cue_file_sectors(&cue);
+				if (sectors < 0)
+					return length_error(disc, cue.file,
+							    sectors);
+				cue.file_start += sectors;
+			}
+			rest = next_word(rest, word, sizeof word);
+			if (rest == NULL || !resolve_path(path, word, cue.file,
+							  sizeof cue.file))
+				return image_error(disc, path, line_num,
+						   "invalid FILE");
+			if (next_word(rest, word, sizeof word) == NULL)
+				word[0] = '\0';
+			if (equal_nocase(word, "WAVE")) {
+				cue.wave = 1;
+			} else if (equal_nocase(word, "BINARY")
+				   || equal_nocase(word, "MOTOROLA")) {
+				cue.wave = 0;
+			} else {
+				return image_error(disc, path, line_num,
+						   "unsupported file type");
+			}
+			cue_file(&cue);
+		} else if (equal_nocase(word, "TRACK")) {
+			rest = next_word(rest, word, sizeof word);
+			number = rest != NULL ? atoi(word) : 0;
+			if (number < 1 || number > 99 || number <= cue.track
+					|| cue.file[0] == '\0'
+					|| next_word(rest, word, sizeof word)
+						== NULL)
+				return image_error(disc, path, line_num,
+						   "invalid TRACK");
+			sector_size = cue_sector_size(word);
+			if (sector_size < 0)
+				return image_error(disc, path, line_num,
+						   "unsupported track mode");
+			if (cue.track == 0)
+				toc->first_track_num = number;
+			toc->last_track_num = number;
+			toc->tracks[number].control =
+				equal_nocase(word, "AUDIO")
+				|| equal_nocase(word, "CDG") ? 0 : DATA_TRACK;
+			cue_track(&cue, number, sector_size);
+		} else if (equal_nocase(word, "INDEX")) {
+			rest = next_word(rest, word, sizeof word);
+			index = rest != NULL ? atoi(word) : -1;
+			if (index < 0 || index > 99 || cue.track == 0
+					|| next_word(rest, word, sizeof word)
+						== NULL
+					|| (pos = parse_msf(word)) < 0)
+				return image_error(disc, path, line_num,
+						   "invalid INDEX");
+			cue_index(&cue, toc, index, pos);
+		} else if (equal_nocase(word, "PREGAP")
+			   || equal_nocase(word, "POSTGAP")) {
+			if (next_word(rest, word, sizeof word) == NULL
+					|| (pos = parse_msf(word)) < 0)
+				return image_error(disc, path, line_num,
+						   "invalid gap");
+			cue.shift += pos;
+		} else if (equal_nocase(word, "REM")) {
+			rest = next_word(rest, word, sizeof word);
+			if (rest != NULL && equal_nocase(word, "SESSION")
+					&& next_word(rest, word, sizeof word)
+						!= NULL
+					&& atoi(word) > 1 && cue.track > 0)
+				cue.new_session = 1;
+		} else if (equal_nocase(word, "CATALOG")) {
+			if (next_word(rest, word, sizeof word) != NULL)
+				set_mcn(disc, word);
+		} else if (equal_nocase(word, "ISRC")) {
+			if (next_word(rest, word, sizeof word) != NULL)
+				set_isrc(disc, cue.track, word);
+		}
+		/* everything else doesn't change the TOC */
+	}
+
+	if (cue.file[0] == '\0')
+		return image_error(disc, path, 0, "no FILE found");
+	sectors = cue_file_sectors(&cue);
+	if (sectors < 0)
+		return length_error(disc, cue.file, sectors);
+	toc->tracks[0].address = cue.file_start + sectors + cue.shift;
+
+	return check_tracks(disc, path, toc, cue.found);
+}
+
+
+/*
+ * cdrdao TOC files
+ * ----------------
+ *
+ * The tracks follow each other without gaps, their lengths are the sum
+ * of their FILE, DATAFILE, SILENCE, ZERO and PREGAP statements.
+ * START or PREGAP set where index 1 is in the track.
+ * CD_TEXT blocks are skipped.
+ */
+
+typedef struct {
+	int track;		/* current track, 0 before the first */
+	int track_start;	/* start of the current track on the disc */
+	int length;		/* sectors of the current track up to here */
+	int start;		/* index 1 of the current track, -1 for 0 */
+	int audio;		/* the current track is an audio track */
+	int sector_size;	/* sector size of the current track */
+	int depth;		/* nesting depth of { } blocks */
+	int found[100];
+} cdrdao_state;
+
+static int cdrdao_sector_size(const char *mode) {
+	static const struct {
+		const char *mode;
+		int size;
+	} modes[] = {
+		{ "AUDIO", 2352 },
+		{ "MODE0", 2336 },
+		{ "MODE1", 2048 },
+		{ "MODE1_RAW", 2352 },
+		{ "MODE2", 2336 },
+		{ "MODE2_FORM1", 2048 },
+		{ "MODE2_FORM2", 2324 },
+		{ "MODE2_FORM_MIX", 2332 },
+		{ "MODE2_RAW", 2352 },
+	};
+	int i;
+
+	for (i = 0; i < (int) (sizeof modes / sizeof modes[0]); i++) {
+		if (equal_nocase(mode, modes[i].mode))
+			return modes[i].size;
+	}
+	return -1;
+}
+
+/* Parse a length as mm:ss:ff, or as samples for audio and bytes for data */
+static int cdrdao_length(cdrdao_state *toc, const char *word) {
+	const char *c;
+
+	if (strchr(word, ':') != NULL)
+		return parse_msf(word);
+
+	for (c = word; *c != '\0'; c++) {
+		if (!isdigit((unsigned char) *c))
+			return -1;
+	}
+	if (c == word)
+		return -1;
+	if (toc->audio)
+		return bytes_to_sectors((file_size) atol(word) * 4,
+					AUDIO_SECTOR_SIZE);
+	return bytes_to_sectors(atol(word), toc->sector_size);
+}
+
+/* Remove // comments and count the { } nesting outside of strings */
+static void cdrdao_strip(cdrdao_state *toc, char line[], int *depth_before) {
+	int quoted = 0;
+	char *c;
+
+	*depth_before = toc->depth;
+	for (c = line; *c != '\0'; c++) {
+		if (*c == '"') {
+			quoted = !quoted;
+		} else if (!quoted && c[0] == '/' && c[1] == '/') {
+			*c = '\0';
+			break;
+		} else if (!quoted && *c == '{') {
+			toc->depth++;
+		} else if (!quoted && *c == '}' && toc->depth > 0) {
+			toc->depth--;
+		}
+	}
+}
+
+static void cdrdao_finish_track(cdrdao_state *toc, mb_disc_toc *mb_toc) {
+	if (toc->track == 0)
+		return;
+	mb_toc->tracks[toc->track].address = toc->track_start
+		+ (toc->start > 0 ? toc->start : 0);
+	toc->found[toc->track] = 1;
+	toc->track_start += toc->length;
+}
+
+/* Handle FILE, AUDIOFILE and DATAFILE */
+static int cdrdao_file(cdrdao_state *toc, const char *path, const char *rest,
+		       int data_file) {
+	char name[PATH_LENGTH];
+	char file_name[PATH_LENGTH];
+	char word[64];
+	file_size size, offset = 0;
+	int start = 0, length = -1;
+
+	rest = next_word(rest, name, sizeof name);
+	if (rest == NULL
+		|| !resolve_path(path, name, file_name, sizeof file_name))
+		return -1;
+
+	rest = next_word(rest, word, sizeof word);
+	if (rest != NULL && word[0] == '#') {
+		offset = atol(word + 1);
+		rest = next_word(rest, word, sizeof word);
+	}
+	if (rest != NULL && !data_file) {
+		start = equal_nocase(word, "0") ? 0 : cdrdao_length(toc, word);
+		rest = next_word(rest, word, sizeof word);
+	}
+	if (rest != NULL)
+		length = cdrdao_length(toc, word);
+	if (start < 0)
+		return -1;
+	if (length >= 0)
+		return length;
+
+	/* the rest of the file */
+	if (!data_file && has_extension(file_name, ".wav"))
+		size = get_wave_data_size(file_name);
+	else
+		size = get_file_size(file_name);
+	if (size == NOT_CD_AUDIO)
+		return NOT_CD_AUDIO;
+	if (size < offset)
+		return -1;
+	length = bytes_to_sectors(size - offset, data_file
+				  ? toc->sector_size : AUDIO_SECTOR_SIZE);
+
+	return length >= start ? length - start : -1;
+}
+
+static int read_cdrdao(mb_disc_private *disc, FILE *file, const char *path,
+		       mb_disc_toc *mb_toc) {
+	char line[LINE_LENGTH];
+	char word[PATH_LENGTH];
+	const char *rest;
+	cdrdao_state toc;
+	int line_num = 0;
+	int depth_before, length;
+
+	memset(&toc, 0, sizeof toc);
+	toc.start = -1;
+
+	while (read_line(file, line, sizeof line, &line_num)) {
+		cdrdao_strip(&toc, line, &depth_before);
+		rest = next_word(line, word, sizeof word);
+		if (rest == NULL || depth_before > 0)
+			continue;
+
+		length = 0;
+		if (equal_nocase(word, "TRACK")) {
+			cdrdao_finish_track(&toc, mb_toc);
+			rest = next_word(rest, word, sizeof word);
+			if (toc.track == 99 || rest == NULL
+				|| (toc.sector_size = cdrdao_sector_size(word))
+					< 0)
+				return image_error(disc, path, line_num,
+						   "invalid TRACK");
+			toc.audio = equal_nocase(word, "AUDIO");
+			/* sub-channel data stored with the sectors */
+			if (next_word(rest, word, sizeof word) != NULL
+					&& (equal_nocase(word, "RW")
+					    || equal_nocase(word, "RW_RAW")))
+				toc.sector_size += SUBCHANNEL_SIZE;
+			toc.track++;
+			toc.length = 0;
+			toc.start = -1;
+			if (toc.track == 1)
+				mb_toc->first_track_num = 1;
+			mb_toc->last_track_num = toc.track;
+			mb_toc->tracks[toc.track].control =
+				toc.audio ? 0 : DATA_TRACK;
+		} else if (equal_nocase(word, "CATALOG")) {
+			if (next_word(rest, word, sizeof word) != NULL)
+				set_mcn(disc, word);
+		} else if (toc.track == 0) {
+			/* the disc type and the global CD_TEXT */
+			continue;
+		} else if (equal_nocase(word, "FILE")
+			   || equal_nocase(word, "AUDIOFILE")) {
+			length = cdrdao_file(&toc, path, rest, 0);
+		} else if (equal_nocase(word, "DATAFILE")) {
+			length = cdrdao_file(&toc, path, rest, 1);
+		} else if (equal_nocase(word, "SILENCE")
+			   || equal_nocase(word, "ZERO")) {
+			/* the length is the last word, after optional modes */
+			while ((rest = next_word(rest, word, sizeof word))
+					!= NULL) {
+				length = cdrdao_length(&toc, word);
+			}
+		} else if (equal_nocase(word, "PREGAP")) {
+			length = next_word(rest, word, sizeof word) != NULL
+				? parse_msf(word) : -1;
+			toc.start = length;
+		} else if (equal_nocase(word, "START")) {
+			/* without a time index 1 is right here */
+			if (next_word(rest, word, sizeof word) != NULL) {
+				toc.start = parse_msf(word);
+				length = toc.start < 0 ? -1 : 0;
+			} else {
+				toc.start = toc.length;
+			}
+		} else if (equal_nocase(word, "ISRC")) {
+			if (next_word(rest, word, sizeof word) != NULL)
+				set_isrc(disc, toc.track, word);
+		}
+
+		if (length == NOT_CD_AUDIO)
+			return image_error(disc, path, line_num,
+					   NOT_CD_AUDIO_MSG);
+		if (length < 0)
+			return image_error(disc, path, line_num,
+					   "invalid length or missing file");
+		toc.length += length;
+	}
+	cdrdao_finish_track(&toc, mb_toc);
+	mb_toc->tracks[0].address = toc.track_start;
+
+	return check_tracks(disc, path, mb_toc, toc.found);
+}
+
+
+/*
+ * CloneCD CCD files
+ * -----------------
+ *
+ * The [Entry] sections are the raw TOC entries of the disc.
+ * Points 1 - 99 are the tracks, point 0xA2 is the lead-out of a session.
+ */
+
+typedef struct {
+	int in_entry;
+	int session;
+	int point;
+	int control;
+	int lba;
+} ccd_entry;
+
+static void ccd_finish_entry(ccd_entry *entry, mb_disc_toc *toc,
+			     int found[], int *leadout_session) {
+	if (!entry->in_entry)
+		return;
+
+	if (entry->point >= 1 && entry->point <= 99) {
+		toc->tracks[entry->point].address = entry->lba;
+		toc->tracks[entry->point].control = entry->control;
+		if (toc->first_track_num == 0
+				|| entry->point < toc->first_track_num)
+			toc->first_track_num = entry->point;
+		if (entry->point > toc->last_track_num)
+			toc->last_track_num = entry->point;
+		found[entry->point] = 1;
+	} else if (entry->point == 0xA2
+			&& entry->session >= *leadout_session) {
+		/* the lead-out of the last session ends the disc */
+		toc->tracks[0].address = entry->lba;
+		*leadout_session = entry->session;
+	}
+	entry->in_entry = 0;
+}
+
+static int read_ccd(mb_disc_private *disc, FILE *file, const char *path,
+		    mb_disc_toc *toc) {
+	char line[LINE_LENGTH];
+	char *key, *value, *end;
+	ccd_entry entry;
+	int found[100];
+	int line_num = 0;
+	int leadout_session = 0;
+	int in_disc = 0;
+
+	memset(&entry, 0, sizeof entry);
+	memset(found, 0, sizeof found);
+
+	while (read_line(file, line, sizeof line, &line_num)) {
+		key = (char *) skip_space(line);
+		end = key + strlen(key);
+		while (end > key && isspace((unsigned char) end[-1]))
+			*--end = '\0';
+
+		if (key[0] == '[') {
+			ccd_finish_entry(&entry, toc, found, &leadout_session);
+			entry.in_entry = strncmp(key, "[Entry", 6) == 0;
+			entry.session = 1;
+			entry.point = 0;
+			entry.control = 0;
+			entry.lba = 0;
+			in_disc = equal_nocase(key, "[Disc]");
+			continue;
+		}
+
+		value = strchr(key, '=');
+		if (value == NULL)
+			continue;
+		*value++ = '\0';
+
+		if (in_disc && equal_nocase(key, "CATALOG")) {
+			set_mcn(disc, value);
+		} else if (!entry.in_entry) {
+			continue;
+		} else if (equal_nocase(key, "Session")) {
+			entry.session = (int) strtol(value, NULL, 0);
+		} else if (equal_nocase(key, "Point")) {
+			entry.point = (int) strtol(value, NULL, 0);
+		} else if (equal_nocase(key, "Control")) {
+			entry.control = (int) strtol(value, NULL, 0);
+		} else if (equal_nocase(key, "PLBA")) {
+			entry.lba = (int) strtol(value, NULL, 10);
+		}
+	}
+	ccd_finish_entry(&entry, toc, found, &leadout_session);
+
+	if (leadout_session == 0)
+		return image_error(disc, path, 0, "no lead-out entry found");
+
+	return check_tracks(disc, path, toc, found);
+}
+
+
+/*
+ * FLAC files
+ * ----------
+ *
+ * Only the metadata blocks at the start of the file are read, the blocks
+ * before the CUESHEET are skipped and the audio frames are never touched.
+ * CUESHEET offsets are in samples, 588 per sector for CD audio.
+ * A track starts at its offset plus the offset of its INDEX 01,
+ * the lead-out is track 170.
+ */
+
+#define FLAC_BLOCK_CUESHEET	5
+#define FLAC_LEADOUT		170
+#define SAMPLES_PER_SECTOR	588
+/* catalog, lead-in, flags and reserved bytes, number of tracks */
+#define FLAC_CUESHEET_SIZE	(128 + 8 + 259 + 1)
+/* offset, number, ISRC, flags and reserved bytes, number of indexes */
+#define FLAC_TRACK_SIZE		(8 + 1 + 12 + 14 + 1)
+/* offset, number, reserved bytes */
+#define FLAC_INDEX_SIZE		(8 + 1 + 3)
+
+/*
+ * Sectors for a 64 bit big-endian sample count, -1 if it doesn't fit.
+ * Divided byte by byte, there is no portable 64 bit type in C89.
+ * Partial sectors count.
+ */
+static int samples_to_sectors(const unsigned char *p) {
+	unsigned long sectors = 0, rest = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		rest = rest << 8 | p[i];
+		sectors = (sectors << 8) + rest / SAMPLES_PER_SECTOR;
+		rest %= SAMPLES_PER_SECTOR;
+		if (sectors >= 1UL << 22)
+			return -1;
+	}
+	return (int) sectors + (rest > 0);
+}
+
+static int read_flac_cuesheet(mb_disc_private *disc, FILE *file,
+			      const char *path, mb_disc_toc *toc) {
+	unsigned char head[FLAC_CUESHEET_SIZE];
+	unsigned char track[FLAC_TRACK_SIZE];
+	unsigned char index[FLAC_INDEX_SIZE];
+	char isrc[ISRC_STR_LENGTH+1];
+	int found[100];
+	int num_tracks, num_indexes, number, start, pos, i, j;
+	int leadout = -1;
+
+	memset(found, 0, sizeof found);
+
+	if (fread(head, 1, sizeof head, file) != sizeof head)
+		return image_error(disc, path, 0, "invalid CUESHEET block");
+	if (!(head[128 + 8] & 0x80))
+		return image_error(disc, path, 0, "CUESHEET is not for a CD");
+	if (head[MCN_STR_LENGTH] == '\0')
+		set_mcn(disc, (const char *) head);
+
+	num_tracks = head[FLAC_CUESHEET_SIZE - 1];
+	for (i = 0; i < num_tracks; i++) {
+		if (fread(track, 1, sizeof track, file) != sizeof track)
+			return image_error(disc, path, 0,
+					   "invalid CUESHEET track");
+		start = samples_to_sectors(track);
+		number = track[8];
+		num_indexes = track[FLAC_TRACK_SIZE - 1];
+
+		if (number == FLAC_LEADOUT) {
+			leadout = start;
+			continue;
+		}
+		if (start < 0 || number < 1 || number > 99
+				|| number <= toc->last_track_num)
+			return image_error(disc, path, 0,
+					   "invalid CUESHEET track");
+		if (toc->last_track_num == 0)
+			toc->first_track_num = number;
+		toc->last_track_num = number;
+		toc->tracks[number].control =
+			track[9 + ISRC_STR_LENGTH] & 0x80 ? DATA_TRACK : 0;
+		memcpy(isrc, track + 9, ISRC_STR_LENGTH);
+		isrc[ISRC_STR_LENGTH] = '\0';
+		set_isrc(disc, number, isrc);
+
+		for (j = 0; j < num_indexes; j++) {
+			if (fread(index, 1, sizeof index, file)
+					!= sizeof index)
+				return image_error(disc, path, 0,
+						   "invalid CUESHEET index");
+			pos = samples_to_sectors(index);
+			if (index[8] == 1 && pos >= 0) {
+				toc->tracks[number].address = start + pos;
+				found[number] = 1;
+			}
+		}
+	}
+
+	if (leadout < 0)
+		return image_error(disc, path, 0, "no lead-out track found");
+	toc->tracks[0].address = leadout;
+
+	return check_tracks(disc, path, toc, found);
+}
+
+static int read_flac(mb_disc_private *disc, FILE *file, const char *path,
+		     mb_disc_toc *toc) {
+	unsigned char header[4];
+	long length;
+	int last = 0;
+
+	if (fread(header, 1, sizeof header, file) != sizeof header
+			|| memcmp(header, "fLaC", 4) != 0)
+		return image_error(disc, path, 0, "not a FLAC file");
+
+	while (!last && fread(header, 1, sizeof header, file)
+			== sizeof header) {
+		last = header[0] & 0x80;
+		length = (long) header[1] << 16 | (long) header[2] << 8
+			| (long) header[3];
+		if ((header[0] & 0x7f) == FLAC_BLOCK_CUESHEET)
+			return read_flac_cuesheet(disc, file, path, toc);
+		if (fseek(file, length, SEEK_CUR) != 0)
+			break;
+	}
+
+	return image_error(disc, path, 0, "no CUESHEET block found");
+}
+
+
+/*
+ * EAC and XLD logs
+ * ----------------
+ *
+ * Both have a table "TOC of the extracted CD" with the start and end
+ * sector of every track:
+ *
+ *     Track |   Start  |  Length  | Start sector | End sector
+ *    ---------------------------------------------------------
+ *        1  |  0:00.00 |  4:27.45 |         0    |    20069
+ *
+ * The heading is translated in localized logs, so the first rows with
+ * five columns, numbers in the first and the last two, are taken.
+ * EAC writes UTF-16 with a byte order mark, XLD UTF-8; non-ASCII
+ * characters are not needed here and read as '?'.
+ * A gap of the size of the gap between sessions before a track
+ * means the track is the data track of an enhanced CD.
+ */
+
+/* Read the next line of an UTF-16LE or ASCII compatible file */
+static int read_log_line(FILE *file, char line[], int length, int utf16) {
+	int c, high, i = 0;
+
+	while ((c = getc(file)) != EOF) {
+		if (utf16) {
+			high = getc(file);
+			if (high == EOF)
+				break;
+			if (high != 0)
+				c = '?';
+		}
+		if (c == '\n')
+			break;
+		if (i < length - 1)
+			line[i++] = (char) c;
+	}
+	line[i] = '\0';
+
+	return c != EOF || i > 0;
+}
+
+/* Parse a row of the TOC table, returns 0 if it isn't one */
+static int parse_log_row(const char *line, int *track, int *start,
+			 int *end) {
+	const char *columns[5];
+	char *rest;
+	int i;
+
+	columns[0] = line;
+	for (i = 1; i < 5; i++) {
+		columns[i] = strchr(columns[i - 1], '|');
+		if (columns[i] == NULL)
+			return 0;
+		columns[i]++;
+	}
+	if (strchr(columns[4], '|') != NULL)
+		return 0;
+
+	*track = (int) strtol(columns[0], &rest, 10);
+	if (rest == columns[0] || *skip_space(rest) != '|')
+		return 0;
+	*start = (int) strtol(columns[3], &rest, 10);
+	if (rest == columns[3] || *skip_space(rest) != '|')
+		return 0;
+	*end = (int) strtol(columns[4], &rest, 10);
+	if (rest == columns[4] || *skip_space(rest) != '\0')
+		return 0;
+
+	return *track >= 1 && *track <= 99 && *start >= 0 && *end >= *start;
+}
+
+static int read_log(mb_disc_private *disc, FILE *file, const char *path,
+		    mb_disc_toc *toc) {
+	char line[LINE_LENGTH];
+	unsigned char bom[3];
+	int found[100];
+	int utf16 = 0, data = 0;
+	int track, start, end;
+	int prev_end = -1;
+	size_t length;
+
+	memset(found, 0, sizeof found);
+
+	/* skip the byte order mark */
+	length = fread(bom, 1, sizeof bom, file);
+	if (length >= 2 && bom[0] == 0xff && bom[1] == 0xfe) {
+		utf16 = 1;
+		length = 2;
+	} else if (length < 3 || memcmp(bom, "\xef\xbb\xbf", 3) != 0) {
+		length = 0;
+	}
+	if (fseek(file, (long) length, SEEK_SET) != 0)
+		return image_error(disc, path, 0, "cannot read file");
+
+	while (read_log_line(file, line, sizeof line, utf16)) {
+		if (!parse_log_row(line, &track, &start, &end)) {
+			/* the table ends with the first other line */
+			if (prev_end >= 0 && strchr(line, '|') == NULL)
+				break;
+			continue;
+		}
+		if (track <= toc->last_track_num || start <= prev_end)
+			return image_error(disc, path, 0,
+					   "invalid TOC table");
+		if (prev_end >= 0 && start - prev_end - 1 >= XA_INTERVAL)
+			data = 1;
+		if (toc->last_track_num == 0)
+			toc->first_track_num = track;
+		toc->last_track_num = track;
+		toc->tracks[track].address = start;
+		toc->tracks[track].control = data ? DATA_TRACK : 0;
+		found[track] = 1;
+		prev_end = end;
+	}
+	toc->tracks[0].address = prev_end + 1;
+
+	return check_tracks(disc, path, toc, found);
+}
+
+
+int mb_disc_read_image(mb_disc_private *disc, const char *path) {
+	mb_disc_toc toc;
+	FILE *file;
+	int ok;
+
+	memset(&toc, 0, sizeof toc);
+
+	file = fopen(path, has_extension(path, ".flac")
+		     || has_extension(path, ".log") ? "rb" : "r");
+	if (file == NULL)
+		return image_error(disc, path, 0, "cannot open file");
+
+	if (has_extension(path, ".flac")) {
+		ok = read_flac(disc, file, path, &toc);
+	} else if (has_extension(path, ".log")) {
+		ok = read_log(disc, file, path, &toc);
+	} else if (has_extension(path, ".cue")) {
+		ok = read_cue(disc, file, path, &toc);
+	} else if (has_extension(path, ".toc")) {
+		ok = read_cdrdao(disc, file, path, &toc);
+	} else if (has_extension(path, ".ccd")) {
+		ok = read_ccd(disc, file, path, &toc);
+	} else {
+		ok = image_error(disc, path, 0, "unknown image format");
+	}
+	fclose(file);
+
+	return ok && mb_disc_load_toc(disc, &toc);
+}
+
+
+/*
+ * One audio file per track
+ * ------------------------
+ *
+ * The lengths come from the headers: the data chunk of WAVE files,
+ * the total samples of the FLAC STREAMINFO block and the sample frames
+ * of the AIFF COMM chunk. The first track starts at 150.
+ * The same headers give the format, which has to be CD audio.
+ */
+
+static unsigned long get_be32(const unsigned char *p) {
+	return (unsigned long) p[0] << 24 | (unsigned long) p[1] << 16
+		| (unsigned long) p[2] << 8 | (unsigned long) p[3];
+}
+
+/* Number of sectors in a FLAC file, < 0 on errors */
+static int get_flac_sectors(FILE *file) {
+	unsigned char header[4 + 4];
+	unsigned char info[34];
+	unsigned char samples[8];
+
+	/* STREAMINFO is always the first block */
+	if (fread(header, 1, sizeof header, file) != sizeof header
+			|| memcmp(header, "fLaC", 4) != 0
+			|| (header[4] & 0x7f) != 0
+			|| fread(info, 1, sizeof info, file) != sizeof info)
+		return -1;
+
+	/* 20 bits sample rate, 3 bits channels - 1, 5 bits sample size - 1 */
+	if (!is_cd_audio((unsigned long) info[10] << 12
+			 | (unsigned long) info[11] << 4 | info[12] >> 4,
+			 (info[12] >> 1 & 0x07) + 1,
+			 ((info[12] & 0x01) << 4 | info[13] >> 4) + 1))
+		return NOT_CD_AUDIO;
+
+	/* the total samples are the low 36 bits of bytes 10 to 17 */
+	memset(samples, 0, sizeof samples);
+	samples[3] = info[13] & 0x0f;
+	memcpy(samples + 4, info + 14, 4);
+	return samples_to_sectors(samples);
+}
+
+/*
+ * Integer part of the 80 bit extended float of the AIFF sample rate,
+ * 0 for rates below 1 or above 32 bits
+ */
+static unsigned long get_aiff_rate(const unsigned char *p) {
+	int exponent = (p[0] & 0x7f) << 8 | p[1];
+
+	if (p[0] & 0x80 || exponent < 16383 || exponent > 16383 + 31)
+		return 0;
+	return get_be32(p + 2) >> (16383 + 31 - exponent);
+}
+
+/* Number of sectors in an AIFF or AIFF-C file, < 0 on errors */
+static int get_aiff_sectors(FILE *file) {
+	unsigned char header[12];
+	unsigned char chunk[8];
+	unsigned char comm[18];
+	unsigned long chunk_size, frames;
+
+	if (fread(header, 1, sizeof header, file) != sizeof header
+			|| memcmp(header, "FORM", 4) != 0
+			|| (memcmp(header + 8, "AIFF", 4) != 0
+			    && memcmp(header + 8, "AIFC", 4) != 0))
+		return -1;
+
+	while (fread(chunk, 1, sizeof chunk, file) == sizeof chunk) {
+		chunk_size = get_be32(chunk + 4);
+		if (memcmp(chunk, "COMM", 4) == 0) {
+			if (chunk_size < sizeof comm
+					|| fread(comm, 1, sizeof comm, file)
+						!= sizeof comm)
+				return -1;
+			/* channels, frames, sample size, sample rate */
+			if (!is_cd_audio(get_aiff_rate(comm + 8),
+					 (comm[0] << 8) | comm[1],
+					 (comm[6] << 8) | comm[7]))
+				return NOT_CD_AUDIO;
+			frames = get_be32(comm + 2);
+			return (int) ((frames + SAMPLES_PER_SECTOR - 1)
+				      / SAMPLES_PER_SECTOR);
+		}
+		/* chunks are padded to an even size */
+		if (fseek(file, (long) (chunk_size + (chunk_size & 1)),
+			  SEEK_CUR) != 0)
+			break;
+	}
+
+	return -1;
+}
+
+/* Number of sectors in an audio file, -1 on errors or NOT_CD_AUDIO */
+static int get_track_file_sectors(const char *path) {
+	FILE *file;
+	int sectors;
+
+	if (has_extension(path, ".wav"))
+		return get_audio_sectors(path, 1);
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+		return -1;
+	if (has_extension(path, ".flac"))
+		sectors = get_flac_sectors(file);
+	else if (has_extension(path, ".aif") || has_extension(path, ".aiff"))
+		sectors = get_aiff_sectors(file);
+	else
+		sectors = -1;
+	fclose(file);
+
+	return sectors;
+}
+
+int mb_disc_get_file_offsets(mb_disc_private *disc, int count,
+			     const char *paths[], int offsets[]) {
+	int i, sectors;
+
+	if (count < 1 || count > 99) {
+		sprintf(disc->error_msg, "invalid number of files: %d", count);
+		return 0;
+	}
+
+	offsets[1] = 150;
+	for (i = 0; i < count; i++) {
+		sectors = get_track_file_sectors(paths[i]);
+		if (sectors == 0)
+			sectors = -1;
+		if (sectors < 0)
+			return length_error(disc, paths[i], sectors);
+		if (i + 1 < count)
+			offsets[i + 2] = offsets[i + 1] + sectors;
+		else
+			offsets[0] = offsets[i + 1] + sectors;
+	}
+
+	return 1;
+}
+
+/* EOF */
@@ -0,0 +1,545 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Read-only index from binary DiscIDs to MusicBrainz cdtoc and medium ids.
+ *
+ * File layout, all numbers in the byte order of the machine that wrote it:
+ *
+ *   header     magic, byte order mark, entry count, reserved
+ *   directory  INDEX_BUCKETS + 1 entry numbers, where the entries with
+ *              the first two digest bytes i start and end
+ *   entries    discid_index_entry, sorted by digest and medium
+ *
+ * DiscIDs are SHA-1 digests, so the first two bytes spread the entries
+ * evenly over the buckets and a lookup is one directory read plus a short
+ * binary search. The file is mapped read-only where possible, so all
+ * processes using the same index share the pages.
+ *
+ * The DiscID filter is a blocked Bloom filter in a file of the same kind:
+ *
+ *   header     magic, byte order mark, number of blocks and of bits
+ *              set per DiscID, reserved up to FILTER_BLOCK_SIZE
+ *   blocks     FILTER_BLOCK_SIZE bytes each, one cache line
+ *
+ * All bits of a DiscID are in one block, so a query touches one
+ * cache line. The digest is already a good hash: its first four bytes
+ * choose the block, the following ones the bits.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(HAVE_MMAP)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+#define INDEX_MAGIC		"DISCIDX1"
+#define INDEX_BYTE_ORDER	0x01020304UL
+#define INDEX_BUCKETS		65536
+
+#define FILTER_MAGIC		"DISCIDF1"
+#define FILTER_BLOCK_SIZE	64
+#define FILTER_BLOCK_BITS	(FILTER_BLOCK_SIZE * 8)
+#define FILTER_BLOCK_WORDS	(FILTER_BLOCK_SIZE / sizeof(unsigned int))
+#define FILTER_MAX_HASHES	8
+
+typedef struct {
+	char magic[8];
+	unsigned int byte_order;
+	unsigned int count;
+	unsigned int reserved[4];
+} index_header;
+
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+} mapped_file;
+
+struct discid_index {
+	mapped_file map;
+	const unsigned int *directory;
+	const discid_index_entry *entries;
+	unsigned int count;
+};
+
+typedef struct {
+	char magic[8];
+	unsigned int byte_order;
+	unsigned int num_blocks;
+	unsigned int num_hashes;
+	unsigned int reserved[(FILTER_BLOCK_SIZE - 8) / 4 - 3];
+} filter_header;
+
+struct discid_filter {
+	mapped_file map;
+	const unsigned int *blocks;
+	unsigned long num_blocks;
+	int num_hashes;
+};
+
+
+static int compare_entries(const void *a, const void *b) {
+	const discid_index_entry *x = (const discid_index_entry *) a;
+	const discid_index_entry *y = (const discid_index_entry *) b;
+	int result;
+
+	result = memcmp(x->digest, y->digest, sizeof x->digest);
+	if (result != 0)
+		return result;
+	if (x->medium != y->medium)
+		return x->medium < y->medium ? -1 : 1;
+	return 0;
+}
+
+static unsigned int get_bucket(const unsigned char digest[]) {
+	return (unsigned int) digest[0] << 8 | digest[1];
+}
+
+/* The lookups use the directory as entry indices without any checks,
+ * so a broken or crafted file has to be rejected when it is opened. */
+static int valid_directory(const unsigned int directory[],
+			   unsigned int count) {
+	unsigned int i;
+
+	if (directory[0] != 0 || directory[INDEX_BUCKETS] != count)
+		return 0;
+	for (i = 0; i < INDEX_BUCKETS; i++) {
+		if (directory[i] > directory[i + 1])
+			return 0;
+	}
+	return 1;
+}
+
+int discid_index_build(const char *path, discid_index_entry *entries,
+		       size_t count) {
+	index_header header;
+	unsigned int *directory;
+	unsigned int bucket;
+	size_t i;
+	FILE *file;
+	int ok;
+
+	assert(path != NULL);
+	assert(entries != NULL || count == 0);
+
+	if (count > 0xffffffffUL)
+		return 0;
+
+	directory = calloc(INDEX_BUCKETS + 1, sizeof(unsigned int));
+	if (directory == NULL)
+		return 0;
+
+	qsort(entries, count, sizeof(discid_index_entry), compare_entries);
+
+	/* count per bucket, then the start of every bucket */
+	for (i = 0; i < count; i++) {
+		directory[get_bucket(entries[i].digest) + 1]++;
+	}
+	for (bucket = 0; bucket < INDEX_BUCKETS; bucket++) {
+		directory[bucket + 1] += directory[bucket];
+	}
+
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, INDEX_MAGIC, sizeof header.magic);
+	header.byte_order = INDEX_BYTE_ORDER;
+	header.count = (unsigned int) count;
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		free(directory);
+		return 0;
+	}
+	ok = fwrite(&header, sizeof header, 1, file) == 1
+		&& fwrite(directory, sizeof(unsigned int), INDEX_BUCKETS + 1,
+			  file) == INDEX_BUCKETS + 1
+		&& fwrite(entries, sizeof(discid_index_entry), count, file)
+			== count;
+	free(directory);
+	if (fclose(file) != 0)
+		ok = 0;
+	if (!ok)
+		remove(path);
+
+	return ok;
+}
+
+/* Map or read the whole file, sets data and size */
+static int load_file(mapped_file *map, const char *path) {
+#if defined(_WIN32)
+	LARGE_INTEGER size;
+
+	map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (map->file == INVALID_HANDLE_VALUE)
+		return 0;
+	if (!GetFileSizeEx(map->file, &size) || size.HighPart != 0
+			|| size.LowPart == 0) {
+		CloseHandle(map->file);
+		return 0;
+	}
+	map->mapping = CreateFileMapping(map->file, NULL, PAGE_READONLY,
+					  0, 0, NULL);
+	if (map->mapping == NULL) {
+		CloseHandle(map->file);
+		return 0;
+	}
+	map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (map->data == NULL) {
+		CloseHandle(map->mapping);
+		CloseHandle(map->file);
+		return 0;
+	}
+	map->size = size.LowPart;
+	return 1;
+#elif defined(HAVE_MMAP)
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return 0;
+	}
+	data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return 0;
+	map->data = (const unsigned char *) data;
+	map->size = (size_t) st.st_size;
+	return 1;
+#else
+	unsigned char *data;
+	long size;
+	FILE *file;
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+		return 0;
+	if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0
+			|| fseek(file, 0, SEEK_SET) != 0
+			|| (data = malloc((size_t) size)) == NULL) {
+		fclose(file);
+		return 0;
+	}
+	if (fread(data, 1, (size_t) size, file) != (size_t) size) {
+		free(data);
+		fclose(file);
+		return 0;
+	}
+	fclose(file);
+	map->data = data;
+	map->size = (size_t) size;
+	return 1;
+#endif
+}
+
+static void unload_file(mapped_file *map) {
+#if defined(_WIN32)
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->mapping);
+	CloseHandle(map->file);
+#elif defined(HAVE_MMAP)
+	munmap((void *) map->data, map->size);
+#else
+	free((void *) map->data);
+#endif
+}
+
+discid_index *discid_index_open(const char *path) {
+	discid_index *index;
+	const index_header *header;
+	size_t expected;
+
+	assert(path != NULL);
+
+	index = calloc(1, sizeof(discid_index));
+	if (index == NULL)
+		return NULL;
+	if (!load_file(&index->map, path)) {
+		free(index);
+		return NULL;
+	}
+
+	header = (const index_header *) index->map.data;
+	if (index->map.size < sizeof(index_header)
+			|| memcmp(header->magic, INDEX_MAGIC,
+				  sizeof header->magic) != 0
+			|| header->byte_order != INDEX_BYTE_ORDER) {
+		discid_index_close(index);
+		return NULL;
+	}
+	index->count = header->count;
+	index->directory = (const unsigned int *)
+		(index->map.data + sizeof(index_header));
+	index->entries = (const discid_index_entry *)
+		(index->directory + INDEX_BUCKETS + 1);
+
+	expected = sizeof(index_header)
+		+ (INDEX_BUCKETS + 1) * sizeof(unsigned int)
+		+ (size_t) index->count * sizeof(discid_index_entry);
+	if (index->map.size != expected
+			|| !valid_directory(index->directory, index->count)) {
+		discid_index_close(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+size_t discid_index_lookup_digest(const discid_index *index,
+				  const unsigned char digest[],
+				  const discid_index_entry **entries) {
+	unsigned int bucket, low, high, middle, end;
+
+	assert(index != NULL);
+	assert(digest != NULL);
+
+	bucket = get_bucket(digest);
+	low = index->directory[bucket];
+	high = index->directory[bucket + 1];
+
+	/* first entry not below the digest */
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (memcmp(index->entries[middle].digest, digest,
+			   DISCID_DIGEST_LENGTH) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	end = low;
+	while (end < index->directory[bucket + 1]
+			&& memcmp(index->entries[end].digest, digest,
+				  DISCID_DIGEST_LENGTH) == 0)
+		end++;
+
+	if (entries != NULL)
+		*entries = index->entries + low;
+	return end - low;
+}
+
+size_t discid_index_lookup(const discid_index *index, DiscId *d,
+			   const discid_index_entry **entries) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+
+	if (!disc->success) {
+		if (entries != NULL)
+			*entries = NULL;
+		return 0;
+	}
+	return discid_index_lookup_digest(index, disc->digest, entries);
+}
+
+size_t discid_index_get_count(const discid_index *index) {
+	assert(index != NULL);
+
+	return index->count;
+}
+
+void discid_index_close(discid_index *index) {
+	if (index == NULL)
+		return;
+
+	unload_file(&index->map);
+	free(index);
+}
+
+
+static unsigned long get_block(const unsigned char digest[],
+			       unsigned long num_blocks) {
+	unsigned long hash;
+
+	hash = (unsigned long) digest[0] << 24 | (unsigned long) digest[1] << 16
+		| (unsigned long) digest[2] << 8 | (unsigned long) digest[3];
+	return hash % num_blocks;
+}
+
+/* The bit in a block for hash number i */
+static unsigned int get_bit(const unsigned char digest[], int i) {
+	return ((unsigned int) digest[4 + 2 * i] << 8 | digest[5 + 2 * i])
+		% FILTER_BLOCK_BITS;
+}
+
+int discid_filter_build(const char *path, const unsigned char *digests,
+			size_t count, int bits_per_id) {
+	filter_header header;
+	unsigned int *blocks, *block;
+	unsigned long num_blocks, bits;
+	const unsigned char *digest;
+	size_t i;
+	int j, num_hashes, ok;
+	FILE *file;
+
+	assert(path != NULL);
+	assert(digests != NULL || count == 0);
+
+	if (bits_per_id <= 0)
+		bits_per_id = 10;
+	/* about ln 2 * bits per DiscID is best */
+	num_hashes = (bits_per_id * 69 + 50) / 100;
+	if (num_hashes < 1)
+		num_hashes = 1;
+	if (num_hashes > FILTER_MAX_HASHES)
+		num_hashes = FILTER_MAX_HASHES;
+
+	bits = (unsigned long) count * bits_per_id;
+	num_blocks = (bits + FILTER_BLOCK_BITS - 1) / FILTER_BLOCK_BITS;
+	if (num_blocks == 0)
+		num_blocks = 1;
+	if (bits / bits_per_id != count || num_blocks > 0xffffffffUL)
+		return 0;
+
+	blocks = calloc(num_blocks, FILTER_BLOCK_SIZE);
+	if (blocks == NULL)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		digest = digests + i * DISCID_DIGEST_LENGTH;
+		block = blocks + get_block(digest, num_blocks)
+			* FILTER_BLOCK_WORDS;
+		for (j = 0; j < num_hashes; j++) {
+			bits = get_bit(digest, j);
+			block[bits / 32] |= 1U << (bits % 32);
+		}
+	}
+
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, FILTER_MAGIC, sizeof header.magic);
+	header.byte_order = INDEX_BYTE_ORDER;
+	header.num_blocks = (unsigned int) num_blocks;
+	header.num_hashes = (unsigned int) num_hashes;
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		free(blocks);
+		return 0;
+	}
+	ok = fwrite(&header, sizeof header, 1, file) == 1
+		&& fwrite(blocks, FILTER_BLOCK_SIZE, num_blocks, file)
+			== num_blocks;
+	free(blocks);
+	if (fclose(file) != 0)
+		ok = 0;
+	if (!ok)
+		remove(path);
+
+	return ok;
+}
+
+discid_filter *discid_filter_open(const char *path) {
+	discid_filter *filter;
+	const filter_header *header;
+
+	assert(path != NULL);
+
+	filter = calloc(1, sizeof(discid_filter));
+	if (filter == NULL)
+		return NULL;
+	if (!load_file(&filter->map, path)) {
+		free(filter);
+		return NULL;
+	}
+
+	header = (const filter_header *) filter->map.data;
+	if (filter->map.size < sizeof(filter_header)
+			|| memcmp(header->magic, FILTER_MAGIC,
+				  sizeof header->magic) != 0
+			|| header->byte_order != INDEX_BYTE_ORDER
+			|| header->num_blocks == 0
+			|| header->num_hashes < 1
+			|| header->num_hashes > FILTER_MAX_HASHES
+			|| filter->map.size != sizeof(filter_header)
+				+ (size_t) header->num_blocks
+					* FILTER_BLOCK_SIZE) {
+		discid_filter_close(filter);
+		return NULL;
+	}
+	filter->num_blocks = header->num_blocks;
+	filter->num_hashes = (int) header->num_hashes;
+	filter->blocks = (const unsigned int *)
+		(filter->map.data + sizeof(filter_header));
+
+	return filter;
+}
+
+int discid_filter_contains_digest(const discid_filter *filter,
+				  const unsigned char digest[]) {
+	const unsigned int *block;
+	unsigned int bit, found = 1;
+	int i;
+
+	assert(filter != NULL);
+	assert(digest != NULL);
+
+	block = filter->blocks + get_block(digest, filter->num_blocks)
+		* FILTER_BLOCK_WORDS;
+	for (i = 0; i < filter->num_hashes; i++) {
+		bit = get_bit(digest, i);
+		found &= block[bit / 32] >> (bit % 32);
+	}
+
+	return (int) (found & 1);
+}
+
+int discid_filter_contains(const discid_filter *filter, DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+
+	if (!disc->success)
+		return 0;
+	return discid_filter_contains_digest(filter, disc->digest);
+}
+
+void discid_filter_close(discid_filter *filter) {
+	if (filter == NULL)
+		return;
+
+	unload_file(&filter->map);
+	free(filter);
+}
+
+/* EOF */
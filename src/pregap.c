@@ -0,0 +1,99 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Search for the start of the pregaps (index 0) in the Q sub-channel.
+ *
+ * The TOC only has the start of index 1 of every track. Every sector
+ * has the track number in its Q sub-channel, so the first sector of a
+ * track can be found with a binary search between the start of the
+ * previous track and index 1. Reading the sectors is left to the
+ * platform code, everything else is the same for all platforms.
+ */
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+
+/*
+ * Check if a sector already belongs to a track, which is true for
+ * its pregap (index 0). Some sectors have the MCN or an ISRC in Q
+ * instead of the position, these are decided by their neighbours:
+ * the previous sector if it has a position, otherwise the next one.
+ * Such a sector right at the start of index 0 is then off by one.
+ * Returns 1 or 0 and -1 if this can't be read.
+ */
+static int sector_in_track(mb_disc_q_reader read_q, void *data, int lba,
+			   int track_num) {
+	int track, status;
+
+	status = read_q(data, lba, &track);
+	if (status != 0)
+		return status < 0 ? -1 : track >= track_num;
+
+	if (read_q(data, lba - 1, &track) == 1)
+		return track >= track_num;
+	if (read_q(data, lba + 1, &track) == 1)
+		return track >= track_num;
+	return -1;
+}
+
+/* Search the first sector of the track, -1 if the search failed */
+static int find_track_start(mb_disc_private *disc, mb_disc_q_reader read_q,
+			    void *data, int track_num) {
+	int low, high, middle, status;
+
+	/* index 0 starts after the first sector of the previous track
+	 * and before index 1, the sector before that is in the track
+	 * if it has a pregap at all */
+	low = disc->track_offsets[track_num - 1] - 150 + 1;
+	high = disc->track_offsets[track_num] - 150 - 1;
+
+	status = sector_in_track(read_q, data, high, track_num);
+	if (status <= 0)
+		return status < 0 ? -1 : high + 1;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		status = sector_in_track(read_q, data, middle, track_num);
+		if (status < 0)
+			return -1;
+		if (status)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return high;
+}
+
+void mb_disc_find_pregaps(mb_disc_private *disc, mb_disc_q_reader read_q,
+			  void *data) {
+	int i, start;
+
+	for (i = disc->first_track_num + 1; i <= disc->last_track_num; i++) {
+		start = find_track_start(disc, read_q, data, i);
+		if (start < 0)
+			disc->track_pregaps[i] = -1;
+		else
+			disc->track_pregaps[i] =
+				disc->track_offsets[i] - 150 - start;
+	}
+}
+
+/* EOF */
@@ -0,0 +1,173 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Progressive reading: the TOC is read right away, the MCN, ISRCs,
+ * CD-TEXT and pregaps are read by a background thread.
+ *
+ * The background thread reads them into a copy of the mb_disc_private
+ * object with the TOC, without reading the TOC again. They are only
+ * taken over when the disc in the drive still has the same TOC summary.
+ */
+
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "thread.h"
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+
+struct mb_disc_background {
+	mb_thread thread;
+	int started;
+	mb_disc_private *disc;
+	mb_disc_private scratch;
+	char *device;
+	unsigned int features;
+	int success;
+	int changed;	/* the disc in the drive has another TOC */
+};
+
+
+static void read_background(void *arg) {
+	struct mb_disc_background *bg = (struct mb_disc_background *) arg;
+	mb_disc_private *disc = bg->disc;
+	int i;
+
+	bg->success = mb_disc_read_features_unportable(&bg->scratch,
+						       bg->device,
+						       bg->features);
+	/* the disc might have been changed in the meantime */
+	if (bg->success && !mb_disc_same_disc(&bg->scratch, bg->device)) {
+		bg->success = 0;
+		bg->changed = 1;
+	}
+	if (!bg->success)
+		return;
+
+	memcpy(disc->mcn, bg->scratch.mcn, sizeof disc->mcn);
+	memcpy(disc->cdtext, bg->scratch.cdtext, sizeof disc->cdtext);
+	memcpy(disc->cdtext_pool, bg->scratch.cdtext_pool,
+	       sizeof disc->cdtext_pool);
+	memcpy(disc->track_pregaps, bg->scratch.track_pregaps,
+	       sizeof disc->track_pregaps);
+	for (i = disc->first_track_num; i <= disc->last_track_num; i++) {
+		memcpy(disc->isrc[i], bg->scratch.isrc[i], sizeof disc->isrc[i]);
+	}
+}
+
+int mb_disc_join_background(mb_disc_private *disc) {
+	struct mb_disc_background *bg = disc->background;
+	int success;
+
+	if (bg == NULL)
+		return 1;
+
+	if (bg->started)
+		mb_thread_join(&bg->thread);
+	success = bg->success;
+
+	/* only set here, the thread must not write the object's error
+	 * while the caller might read it */
+	if (bg->changed) {
+		strcpy(disc->error_msg, MB_MEDIA_CHANGED_MSG);
+		disc->error_code = DISCID_ERROR_MEDIA_CHANGED;
+	} else if (!success) {
+		if (bg->scratch.error_msg[0] != '\0')
+			memcpy(disc->error_msg, bg->scratch.error_msg,
+			       sizeof disc->error_msg);
+		else
+			strcpy(disc->error_msg, "background read failed");
+		disc->error_code = DISCID_ERROR_OTHER;
+	}
+
+	free(bg->device);
+	free(bg);
+	disc->background = NULL;
+
+	return success;
+}
+
+int discid_read_progressive(DiscId *d, const char *device,
+			    unsigned int features) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	char default_device[MB_DEVICE_NAME_LENGTH];
+	struct mb_disc_background *bg;
+	assert(disc != NULL);
+
+	if (device == NULL) {
+		mb_disc_get_default_device_unportable(default_device,
+						      sizeof default_device);
+		device = default_device;
+	}
+
+	if (!discid_read_sparse(d, device, 0))
+		return 0;
+
+	if (!mb_disc_has_feature_unportable(DISCID_FEATURE_MCN))
+		features &= ~DISCID_FEATURE_MCN;
+	if (!mb_disc_has_feature_unportable(DISCID_FEATURE_ISRC))
+		features &= ~DISCID_FEATURE_ISRC;
+	if (!mb_disc_has_feature_unportable(DISCID_FEATURE_CDTEXT))
+		features &= ~DISCID_FEATURE_CDTEXT;
+	if (!mb_disc_has_feature_unportable(DISCID_FEATURE_PREGAP))
+		features &= ~DISCID_FEATURE_PREGAP;
+	if (!(features & (DISCID_FEATURE_MCN | DISCID_FEATURE_ISRC
+			  | DISCID_FEATURE_CDTEXT | DISCID_FEATURE_PREGAP)))
+		return 1;
+
+	bg = calloc(1, sizeof(struct mb_disc_background));
+	if (bg == NULL)
+		return 1;
+	bg->device = malloc(strlen(device) + 1);
+	if (bg->device == NULL) {
+		free(bg);
+		return 1;
+	}
+	strcpy(bg->device, device);
+	bg->disc = disc;
+	bg->features = features;
+	/* the thread only changes its copy, which has the TOC already */
+	memcpy(&bg->scratch, disc, sizeof bg->scratch);
+
+	bg->started = mb_thread_start(&bg->thread, read_background, bg);
+	if (!bg->started) {
+		/* no thread support, the result is still there to wait for */
+		read_background(bg);
+	}
+	disc->background = bg;
+
+	return 1;
+}
+
+int discid_wait(DiscId *d) {
+	mb_disc_private *disc = (mb_disc_private *) d;
+	assert(disc != NULL);
+
+	return mb_disc_join_background(disc);
+}
+
+/* EOF */
@@ -0,0 +1,226 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+
+#include <assert.h>
+
+#include "thread.h"
+
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+#include <unistd.h>
+#endif
+
+
+typedef struct {
+	mb_mutex lock;
+	size_t next;
+	size_t count;
+	size_t chunk;
+	void (*function)(void *, size_t, size_t);
+	void *arg;
+} parallel_job;
+
+
+#if defined(_WIN32)
+
+static DWORD WINAPI run_thread(LPVOID arg) {
+	mb_thread *thread = (mb_thread *) arg;
+	thread->function(thread->arg);
+	return 0;
+}
+
+int mb_thread_start(mb_thread *thread, void (*function)(void *), void *arg) {
+	thread->function = function;
+	thread->arg = arg;
+	thread->handle = CreateThread(NULL, 0, run_thread, thread, 0, NULL);
+	return thread->handle != NULL;
+}
+
+void mb_thread_join(mb_thread *thread) {
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+}
+
+void mb_mutex_init(mb_mutex *mutex) {
+	InitializeCriticalSection(mutex);
+}
+
+void mb_mutex_destroy(mb_mutex *mutex) {
+	DeleteCriticalSection(mutex);
+}
+
+void mb_mutex_lock(mb_mutex *mutex) {
+	EnterCriticalSection(mutex);
+}
+
+void mb_mutex_unlock(mb_mutex *mutex) {
+	LeaveCriticalSection(mutex);
+}
+
+int mb_thread_count(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+#elif defined(HAVE_PTHREAD)
+
+static void *run_thread(void *arg) {
+	mb_thread *thread = (mb_thread *) arg;
+	thread->function(thread->arg);
+	return NULL;
+}
+
+int mb_thread_start(mb_thread *thread, void (*function)(void *), void *arg) {
+	thread->function = function;
+	thread->arg = arg;
+	return pthread_create(&thread->handle, NULL, run_thread, thread) == 0;
+}
+
+void mb_thread_join(mb_thread *thread) {
+	pthread_join(thread->handle, NULL);
+}
+
+void mb_mutex_init(mb_mutex *mutex) {
+	pthread_mutex_init(mutex, NULL);
+}
+
+void mb_mutex_destroy(mb_mutex *mutex) {
+	pthread_mutex_destroy(mutex);
+}
+
+void mb_mutex_lock(mb_mutex *mutex) {
+	pthread_mutex_lock(mutex);
+}
+
+void mb_mutex_unlock(mb_mutex *mutex) {
+	pthread_mutex_unlock(mutex);
+}
+
+int mb_thread_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int) count : 1;
+#else
+	return 1;
+#endif
+}
+
+#else /* no thread support */
+
+int mb_thread_start(mb_thread *thread, void (*function)(void *), void *arg) {
+	(void) thread;
+	(void) function;
+	(void) arg;
+	return 0;
+}
+
+void mb_thread_join(mb_thread *thread) {
+	(void) thread;
+}
+
+void mb_mutex_init(mb_mutex *mutex) {
+	(void) mutex;
+}
+
+void mb_mutex_destroy(mb_mutex *mutex) {
+	(void) mutex;
+}
+
+void mb_mutex_lock(mb_mutex *mutex) {
+	(void) mutex;
+}
+
+void mb_mutex_unlock(mb_mutex *mutex) {
+	(void) mutex;
+}
+
+int mb_thread_count(void) {
+	return 1;
+}
+
+#endif
+
+
+/* Take ranges from the job until there are none left. */
+static void run_parallel_job(void *arg) {
+	parallel_job *job = (parallel_job *) arg;
+	size_t begin, end;
+
+	for (;;) {
+		mb_mutex_lock(&job->lock);
+		begin = job->next;
+		end = job->count - begin > job->chunk
+			? begin + job->chunk : job->count;
+		job->next = end;
+		mb_mutex_unlock(&job->lock);
+
+		if (begin >= end)
+			return;
+
+		job->function(job->arg, begin, end);
+	}
+}
+
+void mb_parallel_for(size_t count, size_t chunk, int num_threads,
+		     void (*function)(void *, size_t, size_t), void *arg) {
+	mb_thread threads[MB_MAX_THREADS];
+	parallel_job job;
+	size_t num_chunks;
+	int i, started;
+
+	assert(chunk > 0);
+
+	if (count == 0)
+		return;
+
+	if (num_threads <= 0)
+		num_threads = mb_thread_count();
+	if (num_threads > MB_MAX_THREADS)
+		num_threads = MB_MAX_THREADS;
+	num_chunks = (count + chunk - 1) / chunk;
+	if ((size_t) num_threads > num_chunks)
+		num_threads = (int) num_chunks;
+
+	if (num_threads <= 1) {
+		function(arg, 0, count);
+		return;
+	}
+
+	mb_mutex_init(&job.lock);
+	job.next = 0;
+	job.count = count;
+	job.chunk = chunk;
+	job.function = function;
+	job.arg = arg;
+
+	/* the calling thread is the first worker */
+	for (started = 0; started < num_threads - 1; started++) {
+		if (!mb_thread_start(&threads[started], run_parallel_job, &job))
+			break;
+	}
+	run_parallel_job(&job);
+	for (i = 0; i < started; i++) {
+		mb_thread_join(&threads[i]);
+	}
+
+	mb_mutex_destroy(&job.lock);
+}
+
+/* EOF */
@@ -0,0 +1,101 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Minimal threading support for internal use.
+ *
+ * Windows threads are used on Windows, pthreads everywhere else
+ * if available. Without thread support mb_thread_start() always fails,
+ * the mutex functions do nothing and mb_parallel_for() runs serially.
+ */
+#ifndef MUSICBRAINZ_DISC_ID_THREAD_H
+#define MUSICBRAINZ_DISC_ID_THREAD_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+#include "discid/discid.h" /* for LIBDISCID_INTERNAL */
+
+typedef struct {
+#if defined(_WIN32)
+	HANDLE handle;
+#elif defined(HAVE_PTHREAD)
+	pthread_t handle;
+#endif
+	void (*function)(void *);
+	void *arg;
+} mb_thread;
+
+#if defined(_WIN32)
+typedef CRITICAL_SECTION mb_mutex;
+#elif defined(HAVE_PTHREAD)
+typedef pthread_mutex_t mb_mutex;
+#else
+typedef int mb_mutex;
+#endif
+
+/* Upper limit for the number of threads used by mb_parallel_for() */
+#define MB_MAX_THREADS 256
+
+/*
+ * Start function(arg) in a new thread.
+ * The thread object has to stay valid until mb_thread_join() returned.
+ * Returns 1 on success and 0 if no thread could be started.
+ */
+LIBDISCID_INTERNAL int mb_thread_start(mb_thread *thread,
+				       void (*function)(void *), void *arg);
+
+/*
+ * Wait for a thread started with mb_thread_start() to finish.
+ */
+LIBDISCID_INTERNAL void mb_thread_join(mb_thread *thread);
+
+LIBDISCID_INTERNAL void mb_mutex_init(mb_mutex *mutex);
+LIBDISCID_INTERNAL void mb_mutex_destroy(mb_mutex *mutex);
+LIBDISCID_INTERNAL void mb_mutex_lock(mb_mutex *mutex);
+LIBDISCID_INTERNAL void mb_mutex_unlock(mb_mutex *mutex);
+
+/*
+ * Return the number of processors available, at least 1.
+ */
+LIBDISCID_INTERNAL int mb_thread_count(void);
+
+/*
+ * Call function(arg, begin, end) for consecutive ranges of at most chunk
+ * elements until all count elements are covered.
+ *
+ * The ranges are handed out to up to num_threads threads (the calling
+ * thread included), each thread takes the next free range as soon as it
+ * is done with the previous one. If num_threads is 0 or lower,
+ * one thread per processor is used.
+ */
+LIBDISCID_INTERNAL void mb_parallel_for(size_t count, size_t chunk,
+			int num_threads,
+			void (*function)(void *, size_t, size_t), void *arg);
+
+#endif /* MUSICBRAINZ_DISC_ID_THREAD_H */
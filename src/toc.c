@@ -34,9 +34,6 @@
 
 #include "discid/discid_private.h"
 
-#define XA_INTERVAL		((60 + 90 + 2) * 75)
-#define DATA_TRACK		0x04
-
 
 int mb_disc_load_toc(mb_disc_private *disc, mb_disc_toc *toc)  {
 	int first_audio_track, last_audio_track, i;
@@ -69,7 +66,8 @@ int mb_disc_load_toc(mb_disc_private *disc, mb_disc_toc *toc)  {
 
 	if (last_audio_track < 0) {
 		snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
-			"no actual audio tracks on disc: CDROM or DVD?");
+			"%s", MB_NO_AUDIO_MSG);
+		disc->error_code = DISCID_ERROR_NO_AUDIO;
 		return 0;
 	}
 
@@ -110,6 +108,8 @@ int mb_disc_load_toc(mb_disc_private *disc, mb_disc_toc *toc)  {
 		disc->track_offsets[0] = track->address - XA_INTERVAL + 150;
 	}
 
+	memcpy(&disc->toc, toc, sizeof(mb_disc_toc));
+
 	return 1;
 }
 
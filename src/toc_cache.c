@@ -0,0 +1,266 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Persistent cache for the data read from a disc.
+ *
+ * There is one small text file per device key, which the platform
+ * code creates from the device identity. The file is only used when the
+ * platform reports that the medium didn't change since it was written.
+ * Files are written to a temporary name first and then renamed,
+ * so concurrent processes never see half written files.
+ */
+
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+	#if (_MSC_VER < 1900)
+		#define snprintf _snprintf
+	#endif
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define mkdir(path, mode) _mkdir(path)
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "discid/discid.h"
+#include "discid/discid_private.h"
+
+#define CACHE_PATH_LENGTH	1024
+#define CACHE_MAGIC		"libdiscid-toc 2"
+
+/* the features that change what is stored in the cache */
+#define CACHED_FEATURES		(DISCID_FEATURE_MCN | DISCID_FEATURE_ISRC)
+
+
+/* empty if the cache is disabled */
+static char cache_dir[CACHE_PATH_LENGTH] = "";
+
+
+/* create the directory if it doesn't exist yet, parents have to exist */
+static int create_dir(const char *path) {
+	return mkdir(path, 0700) == 0 || errno == EEXIST;
+}
+
+/* check the result of snprintf() into buffer,
+ * _snprintf returns -1 and doesn't terminate the string when it is cut */
+static int path_fits(int length, char buffer[], int size) {
+	buffer[size - 1] = '\0';
+	return length >= 0 && length < size;
+}
+
+static int cache_file(const char *key, char path[], int path_length) {
+	return path_fits(snprintf(path, path_length, "%s/toc-%s",
+				  cache_dir, key), path, path_length);
+}
+
+int discid_toc_cache_enable(const char *directory) {
+	char path[CACHE_PATH_LENGTH];
+	const char *base;
+
+	cache_dir[0] = '\0';
+
+	if (directory == NULL) {
+		base = getenv("XDG_CACHE_HOME");
+		if (base != NULL && base[0] != '\0') {
+			if (!create_dir(base))
+				return 0;
+		} else {
+			base = getenv("HOME");
+			if (base == NULL || base[0] == '\0')
+				return 0;
+			if (!path_fits(snprintf(path, sizeof path,
+						       "%s/.cache", base),
+				       path, sizeof path)
+				|| !create_dir(path))
+				return 0;
+			base = path;
+		}
+		if (!path_fits(snprintf(cache_dir, sizeof cache_dir,
+					"%s/libdiscid", base),
+			       cache_dir, sizeof cache_dir)) {
+			cache_dir[0] = '\0';
+			return 0;
+		}
+	} else if (!path_fits(snprintf(cache_dir, sizeof cache_dir,
+				       "%s", directory),
+			      cache_dir, sizeof cache_dir)) {
+		cache_dir[0] = '\0';
+		return 0;
+	}
+
+	if (!create_dir(cache_dir)) {
+		cache_dir[0] = '\0';
+		return 0;
+	}
+
+	return 1;
+}
+
+void discid_toc_cache_disable(void) {
+	cache_dir[0] = '\0';
+}
+
+int mb_disc_toc_cache_enabled(void) {
+	return cache_dir[0] != '\0';
+}
+
+int mb_disc_toc_cache_load(mb_disc_private *disc, const char *key,
+			   unsigned int features) {
+	char path[CACHE_PATH_LENGTH];
+	char line[64];
+	FILE *file;
+	unsigned int cached_features;
+	int i, track, ok;
+
+	if (!mb_disc_toc_cache_enabled() || !cache_file(key, path, sizeof path))
+		return 0;
+
+	/* the CD-TEXT and pregaps aren't stored, they are read again */
+	if ((features & DISCID_FEATURE_CDTEXT
+		&& mb_disc_has_feature_unportable(DISCID_FEATURE_CDTEXT))
+		|| (features & DISCID_FEATURE_PREGAP
+		&& mb_disc_has_feature_unportable(DISCID_FEATURE_PREGAP)))
+		return 0;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return 0;
+
+	ok = fgets(line, sizeof line, file) != NULL
+		&& strncmp(line, CACHE_MAGIC "\n", sizeof line) == 0
+		&& fscanf(file, "features %u", &cached_features) == 1
+		&& (features & CACHED_FEATURES & ~cached_features) == 0
+		&& fscanf(file, " toc %d %d", &disc->first_track_num,
+			  &disc->last_track_num) == 2
+		&& disc->last_track_num >= 1 && disc->last_track_num < 100;
+	for (i = 0; ok && i <= disc->last_track_num; i++) {
+		ok = fscanf(file, " %d", &disc->track_offsets[i]) == 1;
+	}
+	ok = ok && mb_disc_check_toc(disc->first_track_num,
+				     disc->last_track_num,
+				     disc->track_offsets) == NULL;
+
+	/* the full TOC as read from the disc, with control bits */
+	ok = ok && fscanf(file, " full %d %d", &disc->toc.first_track_num,
+			  &disc->toc.last_track_num) == 2
+		&& disc->toc.first_track_num == disc->first_track_num
+		&& disc->toc.last_track_num >= disc->last_track_num
+		&& disc->toc.last_track_num < 100;
+	for (i = 0; ok && i <= disc->toc.last_track_num; i++) {
+		ok = fscanf(file, " %d %d", &disc->toc.tracks[i].control,
+			    &disc->toc.tracks[i].address) == 2;
+	}
+
+	/* the MCN and ISRCs are optional, only take what was asked for */
+	while (ok && fscanf(file, " %63s", line) == 1) {
+		if (strcmp(line, "mcn") == 0) {
+			ok = fscanf(file, " %13s", line) == 1;
+			if (ok && features & DISCID_FEATURE_MCN)
+				strcpy(disc->mcn, line);
+		} else if (strcmp(line, "isrc") == 0) {
+			ok = fscanf(file, " %d %12s", &track, line) == 2
+				&& track >= 1 && track < 100;
+			if (ok && features & DISCID_FEATURE_ISRC)
+				strcpy(disc->isrc[track], line);
+		} else {
+			ok = 0;
+		}
+	}
+	fclose(file);
+
+	if (!ok) {
+		/* don't leave parts of the broken file behind */
+		memset(disc, 0, sizeof(mb_disc_private));
+	}
+
+	return ok;
+}
+
+void mb_disc_toc_cache_store(mb_disc_private *disc, const char *key,
+			     unsigned int features) {
+	char path[CACHE_PATH_LENGTH];
+	char tmp_path[CACHE_PATH_LENGTH];
+	FILE *file;
+	int i, ok;
+
+	if (!mb_disc_toc_cache_enabled() || !cache_file(key, path, sizeof path)
+		|| !path_fits(snprintf(tmp_path, sizeof tmp_path, "%s.%d",
+				       path, (int) getpid()),
+			      tmp_path, sizeof tmp_path))
+		return;
+
+	/* only claim what could actually be read */
+	if (!mb_disc_has_feature_unportable(DISCID_FEATURE_MCN))
+		features &= ~DISCID_FEATURE_MCN;
+	if (!mb_disc_has_feature_unportable(DISCID_FEATURE_ISRC))
+		features &= ~DISCID_FEATURE_ISRC;
+	features &= CACHED_FEATURES;
+
+	file = fopen(tmp_path, "w");
+	if (file == NULL)
+		return;
+
+	fprintf(file, "%s\nfeatures %u\ntoc %d %d", CACHE_MAGIC, features,
+		disc->first_track_num, disc->last_track_num);
+	for (i = 0; i <= disc->last_track_num; i++) {
+		fprintf(file, " %d", disc->track_offsets[i]);
+	}
+	fprintf(file, "\nfull %d %d", disc->toc.first_track_num,
+		disc->toc.last_track_num);
+	for (i = 0; i <= disc->toc.last_track_num; i++) {
+		fprintf(file, " %d %d", disc->toc.tracks[i].control,
+			disc->toc.tracks[i].address);
+	}
+	fprintf(file, "\n");
+	if (disc->mcn[0] != '\0')
+		fprintf(file, "mcn %s\n", disc->mcn);
+	for (i = disc->first_track_num; i <= disc->last_track_num; i++) {
+		if (disc->isrc[i][0] != '\0')
+			fprintf(file, "isrc %d %s\n", i, disc->isrc[i]);
+	}
+	ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+	/* rename() doesn't replace existing files on Windows */
+	remove(path);
+#endif
+	if (!ok || rename(tmp_path, path) != 0)
+		remove(tmp_path);
+}
+
+void mb_disc_toc_cache_remove(const char *key) {
+	char path[CACHE_PATH_LENGTH];
+
+	if (mb_disc_toc_cache_enabled() && cache_file(key, path, sizeof path))
+		remove(path);
+}
+
+/* EOF */
@@ -76,6 +76,14 @@ int mb_disc_unix_open(mb_disc_private *disc, const char *device) {
 int mb_disc_unix_read_toc(int fd, mb_disc_private *disc, mb_disc_toc *toc) {
 	int i;
 
+	/* DVDs and data CDs are rejected without reading every TOC entry */
+	if ( mb_disc_unix_has_audio(fd) == 0 ) {
+		snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
+			 "%s", MB_NO_AUDIO_MSG);
+		disc->error_code = DISCID_ERROR_NO_AUDIO;
+		return 0;
+	}
+
 	/* Find the numbers of the first track (usually 1) and the last track. */
 	if ( !mb_disc_unix_read_toc_header(fd, toc) ) {
 		snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
@@ -109,26 +117,39 @@ int mb_disc_unix_read_toc(int fd, mb_disc_private *disc, mb_disc_toc *toc) {
 	return 1;
 }
 
-int mb_disc_unix_read(mb_disc_private *disc, const char *device,
-		      unsigned int features) {
-	mb_disc_toc toc;
+int mb_disc_unix_read_toc_summary(mb_disc_private *disc, const char *device,
+				  mb_disc_toc *toc, const int tracks[],
+				  int count) {
 	int fd;
-	int i;
+	int i, ok;
 
 	fd = mb_disc_unix_open(disc, device);
 	if (fd < 0)
 		return 0;
 
-
-	if ( !mb_disc_unix_read_toc(fd, disc, &toc) ) {
-		close(fd);
-		return 0;
+	ok = mb_disc_unix_read_toc_header(fd, toc);
+	for (i = 0; ok && i < count; i++) {
+		if (tracks[i] >= toc->first_track_num
+			&& tracks[i] <= toc->last_track_num) {
+			ok = mb_disc_unix_read_toc_entry(fd, tracks[i],
+						&toc->tracks[tracks[i]]);
+		}
 	}
+	ok = ok && mb_disc_unix_read_toc_entry(fd, 0xAA, &toc->tracks[0]);
 
-	if ( !mb_disc_load_toc(disc, &toc) ) {
-		close(fd);
-		return 0;
+	if (!ok) {
+		snprintf(disc->error_msg, MB_ERROR_MSG_LENGTH,
+			 "cannot read table of contents");
 	}
+	close(fd);
+
+	return ok;
+}
+
+/* Read everything but the TOC, which has to be loaded already */
+static void read_features(int fd, mb_disc_private *disc,
+			  unsigned int features) {
+	int i;
 
 	/* Read in the media catalog number */
 	if (features & DISCID_FEATURE_MCN
@@ -144,6 +165,54 @@ int mb_disc_unix_read(mb_disc_private *disc, const char *device,
 		}
 	}
 
+	/* Read the CD-TEXT of all tracks */
+	if (features & DISCID_FEATURE_CDTEXT
+		&& mb_disc_has_feature_unportable(DISCID_FEATURE_CDTEXT)) {
+		mb_disc_unix_read_cdtext(fd, disc);
+	}
+
+	/* Search the pregaps in the sub-channel */
+	if (features & DISCID_FEATURE_PREGAP
+		&& mb_disc_has_feature_unportable(DISCID_FEATURE_PREGAP)) {
+		mb_disc_unix_read_pregaps(fd, disc);
+	}
+}
+
+int mb_disc_unix_read(mb_disc_private *disc, const char *device,
+		      unsigned int features) {
+	mb_disc_toc toc;
+	int fd;
+
+	fd = mb_disc_unix_open(disc, device);
+	if (fd < 0)
+		return 0;
+
+
+	if ( !mb_disc_unix_read_toc(fd, disc, &toc) ) {
+		close(fd);
+		return 0;
+	}
+
+	if ( !mb_disc_load_toc(disc, &toc) ) {
+		close(fd);
+		return 0;
+	}
+
+	read_features(fd, disc, features);
+	close(fd);
+
+	return 1;
+}
+
+int mb_disc_unix_read_features(mb_disc_private *disc, const char *device,
+			       unsigned int features) {
+	int fd;
+
+	fd = mb_disc_unix_open(disc, device);
+	if (fd < 0)
+		return 0;
+
+	read_features(fd, disc, features);
 	close(fd);
 
 	return 1;
@@ -43,6 +43,16 @@ LIBDISCID_INTERNAL int mb_disc_unix_read_toc_header(int fd, mb_disc_toc *toc);
 LIBDISCID_INTERNAL int mb_disc_unix_read_toc_entry(int fd, int track_num,
 						   mb_disc_toc_track *track);
 
+/*
+ * Check quickly if the disc can have audio tracks at all,
+ * before the TOC is read entry by entry.
+ * Returns 1 if it has audio tracks, 0 if it certainly has none
+ * and -1 if this can't be told quickly.
+ *
+ * THIS FUNCTION HAS TO BE IMPLEMENTED FOR THE PLATFORM
+ */
+LIBDISCID_INTERNAL int mb_disc_unix_has_audio(int fd);
+
 /*
  * Read the MCN from the disc
  *
@@ -58,6 +68,23 @@ LIBDISCID_INTERNAL void mb_disc_unix_read_mcn(int fd, mb_disc_private *disc);
 LIBDISCID_INTERNAL void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc,
 					       int track_num);
 
+/*
+ * Read the CD-TEXT of the disc with mb_disc_load_cdtext()
+ *
+ * THIS FUNCTION HAS TO BE IMPLEMENTED FOR THE PLATFORM
+ */
+LIBDISCID_INTERNAL void mb_disc_unix_read_cdtext(int fd,
+						 mb_disc_private *disc);
+
+/*
+ * Find the start of index 0 of the tracks after the first one
+ * and set their track_pregaps
+ *
+ * THIS FUNCTION HAS TO BE IMPLEMENTED FOR THE PLATFORM
+ */
+LIBDISCID_INTERNAL void mb_disc_unix_read_pregaps(int fd,
+						  mb_disc_private *disc);
+
 
 /*
  * provided functions
@@ -73,6 +100,15 @@ LIBDISCID_INTERNAL void mb_disc_unix_read_isrc(int fd, mb_disc_private *disc,
 LIBDISCID_INTERNAL int mb_disc_unix_read(mb_disc_private *disc,
 				const char *device, unsigned int features);
 
+/*
+ * This function is implemented in unix.c and can be used
+ * to implement mb_disc_read_features_unportable
+ * after the above functions are implemented on the platform.
+ * Returns 1 on success and 0 on failure.
+ */
+LIBDISCID_INTERNAL int mb_disc_unix_read_features(mb_disc_private *disc,
+				const char *device, unsigned int features);
+
 /*
  * This function is implemented in unix.c and can be used
  * after the above functions are implemented on the platform.
@@ -82,6 +118,16 @@ LIBDISCID_INTERNAL int mb_disc_unix_read(mb_disc_private *disc,
 LIBDISCID_INTERNAL int mb_disc_unix_read_toc(int fd, mb_disc_private *disc,
 					     mb_disc_toc *toc);
 
+/*
+ * This function is implemented in unix.c and can be used
+ * to implement mb_disc_read_toc_summary_unportable
+ * with the mb_disc_unix_read_toc_* functions.
+ * Returns 1 on success and 0 on failure.
+ */
+LIBDISCID_INTERNAL int mb_disc_unix_read_toc_summary(mb_disc_private *disc,
+				const char *device, mb_disc_toc *toc,
+				const int tracks[], int count);
+
 /*
  * utility function to find an existing device from a candidate list
  */
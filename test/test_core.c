@@ -21,6 +21,7 @@
 --------------------------------------------------------------------------- */
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #include <discid/discid.h>
 #include "test.h"
@@ -33,6 +34,10 @@ int feature_consistent(const char *feature) {
 		return discid_has_feature(DISCID_FEATURE_MCN);
 	} else if (strcmp(feature, DISCID_FEATURE_STR_ISRC) == 0) {
 		return discid_has_feature(DISCID_FEATURE_ISRC);
+	} else if (strcmp(feature, DISCID_FEATURE_STR_CDTEXT) == 0) {
+		return discid_has_feature(DISCID_FEATURE_CDTEXT);
+	} else if (strcmp(feature, DISCID_FEATURE_STR_PREGAP) == 0) {
+		return discid_has_feature(DISCID_FEATURE_PREGAP);
 	} else {
 		return 0;
 	}
@@ -42,6 +47,8 @@ int main(int argc, char *argv[]) {
 	DiscId *d;
 	char *features[DISCID_FEATURE_LENGTH];
 	char *feature;
+	char device[64];
+	int offsets[] = { 10000, 150 };
 	int i, found_features, invalid;
 	int result;
 
@@ -64,11 +71,22 @@ int main(int argc, char *argv[]) {
 	evaluate(!invalid && found_features ==
 			discid_has_feature(DISCID_FEATURE_READ)
 			+ discid_has_feature(DISCID_FEATURE_MCN)
-			+ discid_has_feature(DISCID_FEATURE_ISRC));
+			+ discid_has_feature(DISCID_FEATURE_ISRC)
+			+ discid_has_feature(DISCID_FEATURE_CDTEXT)
+			+ discid_has_feature(DISCID_FEATURE_PREGAP));
 
 	announce("discid_get_default_device");
 	evaluate(strlen(discid_get_default_device()) > 0);
 
+	announce("discid_get_default_device_r");
+	evaluate(discid_get_default_device_r(device, sizeof device)
+		 && equal_str(device, discid_get_default_device()));
+
+	announce("discid_toc_cache_enable");
+	evaluate(discid_toc_cache_enable(".")
+		 && !discid_toc_cache_enable("./does/not/exist"));
+	discid_toc_cache_disable();
+
 	announce("discid_new");
 	d = discid_new();
 	evaluate(d != NULL);
@@ -85,6 +103,21 @@ int main(int argc, char *argv[]) {
 		evaluate(strlen(discid_get_error_msg(d)) > 0);
 	}
 
+	announce("discid_get_error_code");
+	/* a disc in the default drive might also be a data disc */
+	if (result)
+		evaluate(equal_int(discid_get_error_code(d), DISCID_ERROR_NONE));
+	else
+		evaluate(discid_get_error_code(d) != DISCID_ERROR_NONE);
+
+	announce("discid_read_progressive with invalid device");
+	evaluate(!discid_read_progressive(d, "invalid_device_name", UINT_MAX)
+		 && discid_wait(d));
+
+	announce("discid_read_quick with invalid device");
+	discid_put(d, 1, 1, offsets);
+	evaluate(!discid_read_quick(d, "invalid_device_name", 0));
+
 	announce("discid_free");
 	discid_free(d);
 	evaluate(1); /* only segfaults etc. would "show" */
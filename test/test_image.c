@@ -0,0 +1,445 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Tests for discid_read_image().
+ *
+ * The description files and small data files are written
+ * to the current directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <discid/discid.h>
+#include "test.h"
+
+#define SECTOR_SIZE 2352
+
+
+static int offsets[] = {
+	303602,
+	150, 9700, 25887, 39297, 53795, 63735, 77517, 94877, 107270,
+	123552, 135522, 148422, 161197, 174790, 192022, 205545,
+	218010, 228700, 239590, 255470, 266932, 288750,
+};
+
+static void msf(int sectors, char buf[]) {
+	sprintf(buf, "%02d:%02d:%02d", sectors / 4500, sectors / 75 % 60,
+		sectors % 75);
+}
+
+static void write_le32(FILE *file, unsigned long value) {
+	fputc((int) (value & 0xff), file);
+	fputc((int) (value >> 8 & 0xff), file);
+	fputc((int) (value >> 16 & 0xff), file);
+	fputc((int) (value >> 24 & 0xff), file);
+}
+
+/* WAVE header for 16 bit stereo PCM with the given sample rate */
+static void write_wave_header(FILE *file, unsigned long size,
+			      unsigned long rate) {
+	fputs("RIFF", file);
+	write_le32(file, 36 + size);
+	fputs("WAVEfmt ", file);
+	write_le32(file, 16);
+	/* PCM, 2 channels, rate, bytes/s, 4 bytes/frame, 16 bits */
+	write_le32(file, 0x00020001UL);
+	write_le32(file, rate);
+	write_le32(file, rate * 4);
+	write_le32(file, 0x00100004UL);
+	fputs("data", file);
+	write_le32(file, size);
+}
+
+/* Write a data file of the given size, a WAVE file if wave is set */
+static void write_data(const char *path, int sectors, int sector_size,
+		       int wave) {
+	FILE *file = fopen(path, "wb");
+	unsigned long size = (unsigned long) sectors * sector_size;
+
+	if (wave)
+		write_wave_header(file, size, 44100);
+	if (size > 0) {
+		fseek(file, (long) size - 1, SEEK_CUR);
+		fputc(0, file);
+	}
+	fclose(file);
+}
+
+static void write_text(const char *path, const char *text) {
+	FILE *file = fopen(path, "w");
+	fputs(text, file);
+	fclose(file);
+}
+
+/* The test disc as CloneCD file, with a data track in a second session */
+static void write_ccd(const char *path) {
+	FILE *file = fopen(path, "w");
+	int i, entry = 0;
+
+	fprintf(file, "[CloneCD]\nVersion=3\n[Disc]\nTocEntries=26\n"
+		"Sessions=2\nCATALOG=0123456789012\n");
+	for (i = 1; i <= 22; i++) {
+		fprintf(file, "[Entry %d]\nSession=1\nPoint=0x%02x\n"
+			"ADR=0x01\nControl=0x00\nPLBA=%d\n",
+			entry++, i, offsets[i] - 150);
+	}
+	fprintf(file, "[Entry %d]\nSession=1\nPoint=0xa2\nADR=0x01\n"
+		"Control=0x00\nPLBA=%d\n", entry++, offsets[0] - 150);
+	fprintf(file, "[Entry %d]\nSession=2\nPoint=0x17\nADR=0x01\n"
+		"Control=0x04\nPLBA=%d\n", entry++, offsets[0] - 150 + 11400);
+	fprintf(file, "[Entry %d]\nSession=2\nPoint=0xa2\nADR=0x01\n"
+		"Control=0x04\nPLBA=%d\n", entry++, offsets[0] + 20000);
+	fprintf(file, "[TRACK 1]\nMODE=0\nINDEX 1=0\n");
+	fclose(file);
+}
+
+/* The test disc as cdrdao file with silence only */
+static void write_cdrdao(const char *path) {
+	FILE *file = fopen(path, "w");
+	char time[16];
+	int i;
+
+	fprintf(file, "CD_DA\n\nCATALOG \"0123456789012\"\n"
+		"CD_TEXT {\n  LANGUAGE_MAP {\n    0 : EN\n  }\n}\n\n");
+	for (i = 1; i <= 22; i++) {
+		msf((i < 22 ? offsets[i + 1] : offsets[0]) - offsets[i], time);
+		fprintf(file, "// Track %d\nTRACK AUDIO\n", i);
+		if (i == 2)
+			fprintf(file, "ISRC \"USABC1234567\"\n");
+		fprintf(file, "SILENCE %s\n\n", time);
+	}
+	fclose(file);
+}
+
+static void write_be(FILE *file, unsigned long value, int bytes) {
+	while (bytes-- > 0)
+		fputc(bytes < 4 ? (int) (value >> bytes * 8 & 0xff) : 0, file);
+}
+
+static void write_flac_index(FILE *file, int sectors, int number) {
+	write_be(file, (unsigned long) sectors * 588, 8);
+	write_be(file, number, 1);
+	write_be(file, 0, 3);
+}
+
+/* The test disc as FLAC file, track 2 with an index 0 */
+static void write_flac(const char *path) {
+	FILE *file = fopen(path, "wb");
+	char block[396];
+	int i, start;
+
+	fputs("fLaC", file);
+	/* STREAMINFO and PADDING are skipped */
+	write_be(file, 0x00000022UL, 4);
+	memset(block, 0, sizeof block);
+	fwrite(block, 1, 34, file);
+	write_be(file, 0x01000100UL, 4);
+	fwrite(block, 1, 256, file);
+
+	write_be(file, 0x85000000UL | (396 + 23 * 36 + 23 * 12), 4);
+	strcpy(block, "0123456789012");
+	block[136] = (char) 0x80;
+	block[395] = 23;
+	fwrite(block, 1, sizeof block, file);
+	for (i = 1; i <= 23; i++) {
+		start = (i < 23 ? offsets[i] : offsets[0]) - 150;
+		if (i == 2)
+			start -= 75;
+		write_be(file, (unsigned long) start * 588, 8);
+		write_be(file, i < 23 ? i : 170, 1);
+		memset(block, 0, 26);
+		if (i == 2)
+			memcpy(block, "USABC1234567", 12);
+		fwrite(block, 1, 26, file);
+		if (i == 2) {
+			write_be(file, 2, 1);
+			write_flac_index(file, 0, 0);
+			write_flac_index(file, 75, 1);
+		} else if (i < 23) {
+			write_be(file, 1, 1);
+			write_flac_index(file, 0, 1);
+		} else {
+			write_be(file, 0, 1);
+		}
+	}
+	/* the audio frames are never read */
+	fputs("\xff\xf8", file);
+	fclose(file);
+}
+
+/* A FLAC file with just a STREAMINFO block, 2 channels of 16 bits */
+static void write_flac_info(const char *path, unsigned long samples,
+			    unsigned long rate) {
+	FILE *file = fopen(path, "wb");
+	char info[34];
+
+	fputs("fLaC", file);
+	write_be(file, 0x80000022UL, 4);
+	memset(info, 0, sizeof info);
+	info[10] = (char) (rate >> 12);
+	info[11] = (char) (rate >> 4 & 0xff);
+	info[12] = (char) ((rate & 0x0f) << 4 | 0x02);
+	info[13] = (char) 0xf0;
+	fwrite(info, 1, 14, file);
+	write_be(file, samples, 4);
+	fwrite(info, 1, 16, file);
+	fclose(file);
+}
+
+/* An AIFF file with a COMM chunk after another chunk, 44100 Hz */
+static void write_aiff(const char *path, unsigned long frames, int channels) {
+	FILE *file = fopen(path, "wb");
+
+	fputs("FORM", file);
+	write_be(file, 4 + 8 + 3 + 1 + 8 + 18, 4);
+	fputs("AIFFNAME", file);
+	write_be(file, 3, 4);
+	fputs("abc", file);
+	fputc(0, file);
+	fputs("COMM", file);
+	write_be(file, 18, 4);
+	write_be(file, channels, 2);
+	write_be(file, frames, 4);
+	write_be(file, 16, 2);
+	write_be(file, 0x400eac44UL, 4);
+	write_be(file, 0, 6);
+	fclose(file);
+}
+
+/* Write text as UTF-16LE with byte order mark */
+static void write_utf16(FILE *file, const char *text) {
+	while (*text != '\0') {
+		fputc(*text++, file);
+		fputc(0, file);
+	}
+}
+
+/* The test disc as EAC log in UTF-16 or XLD log, with a data track */
+static void write_log(const char *path, int utf16) {
+	FILE *file = fopen(path, "wb");
+	char row[256];
+	int i, start, end;
+
+	if (utf16)
+		fputs("\xff\xfe", file);
+	for (i = 1; i <= 23; i++) {
+		if (i == 1) {
+			sprintf(row, "%s\r\n\r\nTOC of the extracted CD\r\n\r\n"
+				"     Track |   Start  |  Length  | Start sector "
+				"| End sector \r\n    -----------------------\r\n",
+				utf16 ? "Exact Audio Copy V1.0"
+				: "X Lossless Decoder version 20191004");
+			utf16 ? write_utf16(file, row) : fputs(row, file);
+		}
+		start = i < 23 ? offsets[i] - 150 : offsets[0] - 150 + 11400;
+		end = (i < 22 ? offsets[i + 1] : offsets[0]) - 150 - 1;
+		if (i == 23)
+			end = start + 1000;
+		sprintf(row, "       %2d  |  0:00.00 |  0:00.00 |    %6d    "
+			"|   %6d   \r\n", i, start, end);
+		utf16 ? write_utf16(file, row) : fputs(row, file);
+	}
+	sprintf(row, "\r\nTrack  1\r\n\r\n     Filename x.wav\r\n");
+	utf16 ? write_utf16(file, row) : fputs(row, file);
+	fclose(file);
+}
+
+int main(int argc, char *argv[]) {
+	DiscId *d;
+	const char *files[3];
+	discid_result results[3];
+	discid_toc toc;
+	FILE *file;
+	int i, ok;
+
+	d = discid_new();
+
+	announce("discid_read_image unknown format");
+	write_text("test_image.txt", "");
+	evaluate(!discid_read_image(d, "test_image.txt")
+		 && strlen(discid_get_error_msg(d)) > 0);
+
+	announce("discid_read_image missing file");
+	evaluate(!discid_read_image(d, "test_image_missing.cue")
+		 && strlen(discid_get_error_msg(d)) > 0);
+
+	announce("discid_read_image CloneCD");
+	write_ccd("test_image.ccd");
+	evaluate(discid_read_image(d, "test_image.ccd")
+		 && equal_str(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-")
+		 && equal_str(discid_get_mcn(d), "0123456789012"));
+
+	announce("discid_read_image cdrdao");
+	write_cdrdao("test_image.toc");
+	evaluate(discid_read_image(d, "test_image.toc")
+		 && equal_str(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-")
+		 && equal_str(discid_get_mcn(d), "0123456789012")
+		 && equal_str(discid_get_track_isrc(d, 2), "USABC1234567"));
+
+	announce("discid_read_image FLAC");
+	write_flac("test_image.flac");
+	evaluate(discid_read_image(d, "test_image.flac")
+		 && equal_str(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-")
+		 && equal_str(discid_get_mcn(d), "0123456789012")
+		 && equal_str(discid_get_track_isrc(d, 2), "USABC1234567"));
+
+	announce("discid_read_image FLAC without CUESHEET");
+	write_text("test_image_empty.flac", "fLaC\x80");
+	evaluate(!discid_read_image(d, "test_image_empty.flac")
+		 && strlen(discid_get_error_msg(d)) > 0);
+
+	announce("discid_read_image EAC log");
+	write_log("test_image_eac.log", 1);
+	evaluate(discid_read_image(d, "test_image_eac.log")
+		 && equal_str(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-"));
+
+	announce("discid_read_image XLD log");
+	write_log("test_image_xld.log", 0);
+	evaluate(discid_read_image(d, "test_image_xld.log")
+		 && equal_str(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-"));
+
+	announce("discid_read_image_batch");
+	files[0] = "test_image_eac.log";
+	files[1] = "test_image_missing.log";
+	files[2] = "test_image.ccd";
+	evaluate(discid_read_image_batch(files, 3, results, 2) == 2
+		 && results[0].success && !results[1].success
+		 && results[2].success
+		 && results[1].error_msg != NULL
+		 && strstr(results[1].error_msg, "test_image_missing.log")
+			!= NULL
+		 && equal_str(results[2].id, "xUp1F2NkfP8s8jaeFn_Av3jNEI4-"));
+
+	/* one BIN file with a pregap for track 2 */
+	announce("discid_read_image CUE");
+	write_data("test_image.bin", 500, SECTOR_SIZE, 0);
+	write_text("test_image.cue",
+		   "\xef\xbb\xbf" "CATALOG 0123456789012\r\n"
+		   "FILE \"test_image.bin\" BINARY\r\n"
+		   "  TRACK 01 AUDIO\r\n"
+		   "    INDEX 01 00:00:00\r\n"
+		   "  TRACK 02 AUDIO\r\n"
+		   "    ISRC USABC1234567\r\n"
+		   "    INDEX 00 00:03:00\r\n"
+		   "    INDEX 01 00:04:00\r\n");
+	evaluate(discid_read_image(d, "test_image.cue")
+		 && equal_str(discid_get_toc_string(d), "1 2 650 150 450")
+		 && equal_str(discid_get_mcn(d), "0123456789012")
+		 && equal_str(discid_get_track_isrc(d, 2), "USABC1234567"));
+
+	/* EAC style: multiple WAVE files, second session with data */
+	announce("discid_read_image CUE with multiple files");
+	write_data("test_image_1.wav", 300, SECTOR_SIZE, 1);
+	write_data("test_image_2.wav", 200, SECTOR_SIZE, 1);
+	write_data("test_image_3.bin", 1000, 2048, 0);
+	write_text("test_image_multi.cue",
+		   "REM GENRE Rock\n"
+		   "PERFORMER \"Somebody\"\n"
+		   "TITLE \"Something\"\n"
+		   "FILE \"test_image_1.wav\" WAVE\n"
+		   "  TRACK 01 AUDIO\n"
+		   "    TITLE \"One\"\n"
+		   "    INDEX 01 00:00:00\n"
+		   "  TRACK 02 AUDIO\n"
+		   "    INDEX 00 00:03:00\n"
+		   "FILE \"test_image_2.wav\" WAVE\n"
+		   "    INDEX 01 00:00:00\n"
+		   "REM SESSION 02\n"
+		   "FILE \"test_image_3.bin\" BINARY\n"
+		   "  TRACK 03 MODE1/2048\n"
+		   "    INDEX 00 00:00:00\n"
+		   "    INDEX 01 00:02:00\n");
+	evaluate(discid_read_image(d, "test_image_multi.cue")
+		 && equal_str(discid_get_toc_string(d),
+			      "1 2 650 150 450"));
+
+	announce("discid_get_full_toc");
+	evaluate(discid_get_full_toc(d, &toc)
+		 && equal_int(toc.last, 3)
+		 && equal_int(toc.offsets[3], 12050)
+		 && equal_int(toc.offsets[0], 12900)
+		 && equal_int(discid_get_track_control(d, 2), 0)
+		 && equal_int(discid_get_track_control(d, 3), 4)
+		 && strcmp(discid_get_full_id(d), discid_get_id(d)) != 0);
+
+	announce("discid_read_files");
+	write_flac_info("test_image_2.flac", 200 * 588, 44100);
+	write_aiff("test_image_3.aiff", 100 * 588 - 10, 2);
+	files[0] = "test_image_1.wav";
+	files[1] = "test_image_2.flac";
+	files[2] = "test_image_3.aiff";
+	evaluate(discid_read_files(d, 3, files)
+		 && equal_str(discid_get_toc_string(d),
+			      "1 3 750 150 450 650"));
+
+	announce("discid_read_files unknown format");
+	files[1] = "test_image.txt";
+	evaluate(!discid_read_files(d, 3, files)
+		 && strlen(discid_get_error_msg(d)) > 0);
+
+	announce("discid_read_files not CD audio");
+	file = fopen("test_image_48k.wav", "wb");
+	write_wave_header(file, 0, 48000);
+	fclose(file);
+	write_flac_info("test_image_48k.flac", 200 * 588, 48000);
+	write_aiff("test_image_mono.aiff", 100 * 588, 1);
+	ok = 1;
+	for (i = 0; i < 3; i++) {
+		files[0] = i == 0 ? "test_image_48k.wav" : i == 1
+			? "test_image_48k.flac" : "test_image_mono.aiff";
+		ok = ok && !discid_read_files(d, 1, files)
+			&& strstr(discid_get_error_msg(d), "not CD audio")
+				!= NULL;
+	}
+	evaluate(ok);
+
+	announce("discid_read_image CUE without track");
+	write_text("test_image_empty.cue",
+		   "FILE \"test_image_1.wav\" WAVE\n");
+	evaluate(!discid_read_image(d, "test_image_empty.cue")
+		 && strlen(discid_get_error_msg(d)) > 0);
+
+	remove("test_image.txt");
+	remove("test_image.ccd");
+	remove("test_image.toc");
+	remove("test_image.flac");
+	remove("test_image_empty.flac");
+	remove("test_image_eac.log");
+	remove("test_image_xld.log");
+	remove("test_image.bin");
+	remove("test_image.cue");
+	remove("test_image_1.wav");
+	remove("test_image_2.wav");
+	remove("test_image_3.bin");
+	remove("test_image_2.flac");
+	remove("test_image_3.aiff");
+	remove("test_image_multi.cue");
+	remove("test_image_empty.cue");
+	remove("test_image_48k.wav");
+	remove("test_image_48k.flac");
+	remove("test_image_mono.aiff");
+
+	discid_free(d);
+
+	return !test_result();
+}
+
+/* EOF */
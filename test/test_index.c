@@ -0,0 +1,234 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Tests for the DiscID index, the DiscID filter and the fuzzy TOC index.
+ *
+ * The index files are written to the current directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <discid/discid.h>
+#include "test.h"
+
+#define NUM_ENTRIES 5000
+
+
+static int offsets[] = {
+	303602,
+	150, 9700, 25887, 39297, 53795, 63735, 77517, 94877, 107270,
+	123552, 135522, 148422, 161197, 174790, 192022, 205545,
+	218010, 228700, 239590, 255470, 266932, 288750,
+};
+
+/* Entries for the test disc with different lead-outs,
+ * the first one on two mediums */
+static discid_index_entry *create_entries(DiscId *d) {
+	discid_index_entry *entries;
+	int i, leadout = offsets[0];
+
+	entries = calloc(NUM_ENTRIES, sizeof(discid_index_entry));
+	for (i = 0; i < NUM_ENTRIES; i++) {
+		offsets[0] = leadout + (i > 0 ? i - 1 : 0);
+		discid_put(d, 1, 22, offsets);
+		discid_get_id_binary(d, entries[i].digest);
+		entries[i].cdtoc = i > 0 ? i : 1;
+		entries[i].medium = NUM_ENTRIES - i;
+	}
+	offsets[0] = leadout;
+
+	return entries;
+}
+
+/* Variants of the test disc for the fuzzy index */
+static void create_tocs(discid_toc tocs[]) {
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		tocs[i].first = 1;
+		tocs[i].last = 22;
+		memcpy(tocs[i].offsets, offsets, sizeof offsets);
+	}
+	/* shifted as a whole */
+	for (i = 0; i <= 22; i++) {
+		tocs[1].offsets[i] += 100;
+	}
+	/* one track 10 sectors longer, the next one shorter */
+	tocs[2].offsets[5] += 10;
+	/* one track 200 sectors longer */
+	tocs[3].offsets[5] += 200;
+	/* one track less */
+	tocs[4].last = 21;
+	/* invalid */
+	tocs[5].offsets[0] = 0;
+}
+
+/* Copy a file with a huge number written at the given offset */
+static int corrupt_file(const char *path, const char *copy, long offset) {
+	FILE *in, *out;
+	int c, ok;
+	long i;
+
+	in = fopen(path, "rb");
+	if (in == NULL)
+		return 0;
+	out = fopen(copy, "wb");
+	if (out == NULL) {
+		fclose(in);
+		return 0;
+	}
+	for (i = 0; (c = getc(in)) != EOF; i++) {
+		putc(i >= offset && i < offset + 4 ? 0x7f : c, out);
+	}
+	ok = i > offset + 4;
+	fclose(in);
+	ok = fclose(out) == 0 && ok;
+
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	DiscId *d;
+	discid_index *index;
+	discid_index_entry *entries;
+	const discid_index_entry *found;
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	discid_fuzzy *fuzzy;
+	discid_filter *filter;
+	unsigned char *digests;
+	discid_toc tocs[6];
+	discid_fuzzy_match matches[3];
+	size_t count;
+	int i, ok;
+
+	d = discid_new();
+
+	announce("discid_index_open missing file");
+	evaluate(discid_index_open("test_index_missing.idx") == NULL);
+
+	announce("discid_index_build");
+	entries = create_entries(d);
+	digests = malloc(NUM_ENTRIES * DISCID_DIGEST_LENGTH);
+	evaluate(discid_index_build("test_index.idx", entries, NUM_ENTRIES));
+
+	announce("discid_index_open");
+	index = discid_index_open("test_index.idx");
+	evaluate(index != NULL
+		 && discid_index_get_count(index) == NUM_ENTRIES);
+
+	announce("discid_index_lookup");
+	discid_put(d, 1, 22, offsets);
+	count = discid_index_lookup(index, d, &found);
+	evaluate(count == 2 && found[0].cdtoc == 1 && found[1].cdtoc == 1
+		 && found[0].medium == NUM_ENTRIES - 1
+		 && found[1].medium == NUM_ENTRIES);
+
+	announce("discid_index_lookup_digest all entries");
+	ok = 1;
+	for (i = 0; i < NUM_ENTRIES && ok; i++) {
+		count = discid_index_lookup_digest(index, entries[i].digest,
+						   &found);
+		ok = count >= 1 && memcmp(found[0].digest, entries[i].digest,
+					  DISCID_DIGEST_LENGTH) == 0;
+	}
+	evaluate(ok);
+
+	announce("discid_index_lookup_digest unknown");
+	memset(digest, 0xff, sizeof digest);
+	evaluate(discid_index_lookup_digest(index, digest, &found) == 0);
+
+	announce("discid_index_open invalid file");
+	fclose(fopen("test_index_empty.idx", "wb"));
+	evaluate(discid_index_open("test_index_empty.idx") == NULL);
+
+	announce("discid_index_open broken directory");
+	evaluate(corrupt_file("test_index.idx", "test_index_broken.idx",
+			      32 + 4 * 100)
+		 && discid_index_open("test_index_broken.idx") == NULL);
+
+	announce("discid_filter_build");
+	for (i = 0; i < NUM_ENTRIES; i++) {
+		memcpy(digests + i * DISCID_DIGEST_LENGTH, entries[i].digest,
+		       DISCID_DIGEST_LENGTH);
+	}
+	/* the test disc is in the first half */
+	discid_get_id_binary(d, entries[0].digest);
+	memcpy(digests, entries[0].digest, DISCID_DIGEST_LENGTH);
+	evaluate(discid_filter_build("test_index.filter", digests,
+				     NUM_ENTRIES / 2, 16));
+
+	announce("discid_filter_contains");
+	filter = discid_filter_open("test_index.filter");
+	ok = filter != NULL;
+	/* all known, few false positives */
+	count = 0;
+	for (i = 0; i < NUM_ENTRIES && ok; i++) {
+		if (i < NUM_ENTRIES / 2)
+			ok = discid_filter_contains_digest(filter,
+							   entries[i].digest);
+		else
+			count += discid_filter_contains_digest(filter,
+							entries[i].digest);
+	}
+	evaluate(ok && count < NUM_ENTRIES / 2 / 100
+		 && discid_filter_contains(filter, d));
+	discid_filter_close(filter);
+
+	announce("discid_filter_open invalid file");
+	evaluate(discid_filter_open("test_index.idx") == NULL);
+
+	announce("discid_fuzzy_build");
+	create_tocs(tocs);
+	fuzzy = discid_fuzzy_build(tocs, 6);
+	evaluate(fuzzy != NULL && discid_fuzzy_get_count(fuzzy) == 5);
+
+	announce("discid_fuzzy_lookup");
+	discid_put(d, 1, 22, offsets);
+	count = discid_fuzzy_lookup(fuzzy, d, 20, matches, 3);
+	evaluate(count == 3
+		 && matches[0].distance == 0 && matches[1].distance == 0
+		 && matches[0].toc + matches[1].toc == 1
+		 && matches[2].toc == 2 && matches[2].distance == 20
+		 && matches[2].max_deviation == 10);
+
+	announce("discid_fuzzy_lookup limited");
+	count = discid_fuzzy_lookup(fuzzy, d, 1000, matches, 2);
+	evaluate(count == 2
+		 && matches[0].distance == 0 && matches[1].distance == 0);
+
+	announce("discid_fuzzy_lookup exact");
+	count = discid_fuzzy_lookup(fuzzy, d, 0, matches, 3);
+	evaluate(count == 2);
+
+	discid_fuzzy_free(fuzzy);
+	discid_index_close(index);
+	free(entries);
+	free(digests);
+	remove("test_index.idx");
+	remove("test_index.filter");
+	remove("test_index_empty.idx");
+	remove("test_index_broken.idx");
+	discid_free(d);
+
+	return !test_result();
+}
+
+/* EOF */
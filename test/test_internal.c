@@ -0,0 +1,244 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Tests for internal functions of the library, which is compiled
+ * into this test because they aren't exported.
+ *
+ * The cache files are written to the current directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <discid/discid.h>
+#include "discid/discid_private.h"
+#include "test.h"
+
+#define CACHE_KEY "test_internal"
+
+
+static int offsets[] = {
+	303602,
+	150, 9700, 25887, 39297, 53795, 63735, 77517, 94877, 107270,
+	123552, 135522, 148422, 161197, 174790, 192022, 205545,
+	218010, 228700, 239590, 255470, 266932, 288750,
+};
+
+
+static void test_toc_cache(void) {
+	DiscId *d = discid_new();
+	mb_disc_private *disc = (mb_disc_private *) d;
+	mb_disc_private *loaded;
+	FILE *file;
+
+	loaded = calloc(1, sizeof(mb_disc_private));
+	discid_toc_cache_enable(".");
+
+	announce("mb_disc_toc_cache_store");
+	discid_put(d, 1, 22, offsets);
+	strcpy(disc->mcn, "0123456789012");
+	mb_disc_toc_cache_store(disc, CACHE_KEY, DISCID_FEATURE_MCN);
+	evaluate(mb_disc_toc_cache_load(loaded, CACHE_KEY, DISCID_FEATURE_MCN)
+		 && equal_int(loaded->last_track_num, 22)
+		 && memcmp(loaded->track_offsets, offsets,
+			   sizeof offsets) == 0
+		 && equal_int(loaded->toc.last_track_num, 22)
+		 && equal_int(loaded->toc.tracks[0].address, offsets[0] - 150)
+		 && equal_str(loaded->mcn, "0123456789012"));
+
+	/* the ISRCs weren't read when the TOC was stored */
+	announce("mb_disc_toc_cache_load missing feature");
+	memset(loaded, 0, sizeof(mb_disc_private));
+	evaluate(!mb_disc_has_feature_unportable(DISCID_FEATURE_ISRC)
+		 || !mb_disc_toc_cache_load(loaded, CACHE_KEY,
+					    DISCID_FEATURE_ISRC));
+
+	announce("mb_disc_toc_cache_remove");
+	mb_disc_toc_cache_remove(CACHE_KEY);
+	memset(loaded, 0, sizeof(mb_disc_private));
+	evaluate(!mb_disc_toc_cache_load(loaded, CACHE_KEY, 0));
+
+	announce("mb_disc_toc_cache_load broken file");
+	file = fopen("toc-" CACHE_KEY, "w");
+	fputs("libdiscid-toc 2\nfeatures 0\ntoc 1 2 500 150\n", file);
+	fclose(file);
+	memset(loaded, 0, sizeof(mb_disc_private));
+	evaluate(!mb_disc_toc_cache_load(loaded, CACHE_KEY, 0)
+		 && equal_int(loaded->last_track_num, 0));
+	mb_disc_toc_cache_remove(CACHE_KEY);
+
+	discid_toc_cache_disable();
+	free(loaded);
+	discid_free(d);
+}
+
+/* Q sub-channel of the pregap test, SECTOR_NO_POSITION for the MCN */
+#define SECTOR_NO_POSITION	0
+#define SECTOR_UNREADABLE	-1
+
+static int q_tracks[600];
+
+static int read_q_map(void *data, int lba, int *track_num) {
+	const int *tracks = (const int *) data;
+
+	if (lba < 0 || lba >= 600 || tracks[lba] == SECTOR_UNREADABLE)
+		return -1;
+	if (tracks[lba] == SECTOR_NO_POSITION)
+		return 0;
+	*track_num = tracks[lba];
+	return 1;
+}
+
+/*
+ * Five tracks of 100 sectors: track 2 with a pregap of 20, track 3
+ * without one, track 4 unreadable before index 1, track 5 with a pregap
+ * of 10. Some sectors have no position, decided by their neighbours.
+ */
+static void test_pregaps(void) {
+	mb_disc_private *disc;
+	int i;
+
+	disc = calloc(1, sizeof(mb_disc_private));
+	disc->first_track_num = 1;
+	disc->last_track_num = 5;
+	for (i = 1; i <= 5; i++) {
+		disc->track_offsets[i] = 150 + (i - 1) * 100;
+	}
+	disc->track_offsets[0] = 150 + 500;
+	for (i = 0; i < 600; i++) {
+		q_tracks[i] = i / 100 + 1;
+	}
+	for (i = 80; i < 100; i++) {
+		q_tracks[i] = 2;
+	}
+	for (i = 290; i < 300; i++) {
+		q_tracks[i] = SECTOR_UNREADABLE;
+	}
+	for (i = 390; i < 400; i++) {
+		q_tracks[i] = 5;
+	}
+	/* right before and in the pregap of track 2, before track 3 */
+	q_tracks[79] = SECTOR_NO_POSITION;
+	q_tracks[90] = SECTOR_NO_POSITION;
+	q_tracks[199] = SECTOR_NO_POSITION;
+	/* the start of the pregap of track 5 after another sector
+	 * without position, decided by the next sector */
+	q_tracks[389] = SECTOR_NO_POSITION;
+	q_tracks[390] = SECTOR_NO_POSITION;
+
+	announce("mb_disc_find_pregaps");
+	mb_disc_find_pregaps(disc, read_q_map, q_tracks);
+	evaluate(equal_int(disc->track_pregaps[2], 20)
+		 && equal_int(disc->track_pregaps[3], 0)
+		 && equal_int(disc->track_pregaps[4], -1)
+		 && equal_int(disc->track_pregaps[5], 10));
+
+	announce("mb_disc_find_pregaps without sub-channel");
+	for (i = 0; i < 600; i++) {
+		q_tracks[i] = SECTOR_UNREADABLE;
+	}
+	mb_disc_find_pregaps(disc, read_q_map, q_tracks);
+	evaluate(equal_int(disc->track_pregaps[2], -1)
+		 && equal_int(disc->track_pregaps[5], -1));
+
+	free(disc);
+}
+
+/* Write a CD-TEXT pack with 12 bytes of text and the CRC */
+static void write_pack(unsigned char *pack, int type, int track,
+		       int block, int char_pos, const char *text,
+		       int broken) {
+	unsigned int crc = 0;
+	int i, bit;
+
+	pack[0] = (unsigned char) type;
+	pack[1] = (unsigned char) track;
+	pack[2] = 0;
+	pack[3] = (unsigned char) (block << 4 | char_pos);
+	memcpy(pack + 4, text, 12);
+	for (i = 0; i < 16; i++) {
+		crc ^= (unsigned int) pack[i] << 8;
+		for (bit = 0; bit < 8; bit++) {
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	crc = ~crc & 0xffff;
+	if (broken)
+		crc ^= 1;
+	pack[16] = (unsigned char) (crc >> 8);
+	pack[17] = (unsigned char) (crc & 0xff);
+}
+
+static const char *get_cdtext(mb_disc_private *disc, int track, int field) {
+	return disc->cdtext_pool + disc->cdtext[track][field];
+}
+
+static void test_cdtext(void) {
+	mb_disc_private *disc;
+	unsigned char packs[7][MB_CDTEXT_PACK_SIZE];
+
+	disc = calloc(1, sizeof(mb_disc_private));
+
+	/* titles: track 1 continued in the next pack, track 2 the same */
+	write_pack(packs[0], 0x80, 0, 0, 0, "Album\0Track1", 0);
+	write_pack(packs[1], 0x80, 1, 0, 6, "Long\0\t\0Three", 0);
+	write_pack(packs[2], 0x80, 3, 0, 5, "\0\0\0\0\0\0\0\0\0\0\0", 0);
+	/* performers: the end of track 1 and the start of track 2 lost */
+	write_pack(packs[3], 0x81, 0, 0, 0, "Artist\0Perf1", 0);
+	write_pack(packs[4], 0x81, 1, 0, 5, "x\0Perf2Perf2", 1);
+	write_pack(packs[5], 0x81, 2, 0, 10, "rf2\0P3\0\0\0\0\0\0", 0);
+	/* a second language */
+	write_pack(packs[6], 0x80, 0, 1, 0, "Other\0\0\0\0\0\0\0", 0);
+
+	announce("mb_disc_load_cdtext");
+	evaluate(mb_disc_load_cdtext(disc, packs[0], 7)
+		 && equal_str(get_cdtext(disc, 0, DISCID_CDTEXT_TITLE),
+			      "Album")
+		 && equal_str(get_cdtext(disc, 1, DISCID_CDTEXT_TITLE),
+			      "Track1Long")
+		 && equal_str(get_cdtext(disc, 2, DISCID_CDTEXT_TITLE),
+			      "Track1Long")
+		 && equal_str(get_cdtext(disc, 3, DISCID_CDTEXT_TITLE),
+			      "Three"));
+
+	announce("mb_disc_load_cdtext wrong CRC");
+	evaluate(equal_str(get_cdtext(disc, 0, DISCID_CDTEXT_PERFORMER),
+			   "Artist")
+		 && equal_str(get_cdtext(disc, 1, DISCID_CDTEXT_PERFORMER), "")
+		 && equal_str(get_cdtext(disc, 2, DISCID_CDTEXT_PERFORMER), "")
+		 && equal_str(get_cdtext(disc, 3, DISCID_CDTEXT_PERFORMER),
+			      "P3"));
+
+	announce("mb_disc_load_cdtext only wrong CRCs");
+	evaluate(!mb_disc_load_cdtext(disc, packs[4], 1)
+		 && equal_str(get_cdtext(disc, 0, DISCID_CDTEXT_TITLE), ""));
+
+	free(disc);
+}
+
+int main(int argc, char *argv[]) {
+	test_toc_cache();
+	test_pregaps();
+	test_cdtext();
+
+	return !test_result();
+}
+
+/* EOF */
@@ -21,16 +21,106 @@
 
 --------------------------------------------------------------------------- */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <discid/discid.h>
 #include <discid/discid_private.h>
 #include "test.h"
 
+#define BATCH_SIZE 3000
+
+
+/* Compare discid_compute_batch() with discid_put() for many TOCs,
+ * every 7th TOC is invalid. */
+int test_batch(DiscId *d, int *offsets) {
+	discid_toc *tocs;
+	discid_result *results;
+	int i, ok = 1;
+	size_t valid;
+
+	tocs = calloc(BATCH_SIZE, sizeof(discid_toc));
+	results = calloc(BATCH_SIZE, sizeof(discid_result));
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		tocs[i].first = 1;
+		tocs[i].last = 1 + i % 22;
+		memcpy(tocs[i].offsets, offsets, sizeof(int) * 23);
+		tocs[i].offsets[0] = offsets[tocs[i].last + 1 < 23 ?
+					     tocs[i].last + 1 : 0] + i % 75;
+		if (i % 7 == 0)
+			tocs[i].offsets[1] = tocs[i].offsets[0] + 1;
+	}
+
+	valid = discid_compute_batch(tocs, BATCH_SIZE, results, 4);
+
+	for (i = 0; i < BATCH_SIZE && ok; i++) {
+		if (discid_put(d, tocs[i].first, tocs[i].last,
+			       tocs[i].offsets)) {
+			ok = results[i].success
+				&& equal_str(results[i].id, discid_get_id(d))
+				&& equal_str(results[i].freedb_id,
+					     discid_get_freedb_id(d))
+				&& equal_str(results[i].accuraterip_id,
+					     discid_get_accuraterip_id(d))
+				&& equal_str(results[i].ctdb_id,
+					     discid_get_ctdb_id(d));
+		} else {
+			ok = !results[i].success
+				&& equal_str(results[i].error_msg,
+					     discid_get_error_msg(d));
+		}
+	}
+
+	free(results);
+	free(tocs);
+
+	return ok && equal_int((int) valid, BATCH_SIZE - BATCH_SIZE / 7 - 1);
+}
+
+/* Compare the test disc with a changed copy of it */
+int test_compare(DiscId *d, int *offsets, int track, int change,
+		 discid_comparison *result) {
+	DiscId *other = discid_new();
+	int changed[100];
+	int i, last = 22, ok;
+
+	memcpy(changed, offsets, sizeof(int) * 23);
+	if (track < 0) {
+		/* a data track after the lead-out */
+		changed[23] = changed[0] + 11400;
+		changed[0] = changed[23] + 5000;
+		last = 23;
+	} else if (track == 0) {
+		for (i = 0; i <= 22; i++) {
+			changed[i] += change;
+		}
+	} else {
+		changed[track] += change;
+	}
+
+	discid_put(d, 1, 22, offsets);
+	ok = discid_put(other, 1, last, changed)
+		&& discid_compare(d, other, result);
+	discid_free(other);
+
+	return ok;
+}
 
 int main(int argc, char *argv[]) {
-	DiscId *d;
+	DiscId *d, *d2;
 	char *expected;
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	unsigned char decoded[DISCID_DIGEST_LENGTH];
+	char id[DISCID_ID_LENGTH + 1];
+	char ids[2 * DISCID_ID_LENGTH + 1];
+	unsigned char digests[2 * DISCID_DIGEST_LENGTH];
+	size_t hits, misses;
+	discid_comparison comparison;
+	discid_variant variants[9];
+	discid_toc toc;
+	int enhanced[100];
+	int offsets2[100];
 	int offsets[] = {
 		303602,
 		150, 9700, 25887, 39297, 53795, 63735, 77517, 94877, 107270,
@@ -90,10 +180,58 @@ int main(int argc, char *argv[]) {
 	evaluate(equal_str(discid_get_id(d),
 			   "xUp1F2NkfP8s8jaeFn_Av3jNEI4-"));
 
+	/* binary MusicBrainz DiscID */
+	announce("discid_get_id_binary");
+	evaluate(discid_get_id_binary(d, digest));
+
+	announce("discid_id_encode");
+	discid_id_encode(digest, id);
+	evaluate(equal_str(id, "xUp1F2NkfP8s8jaeFn_Av3jNEI4-"));
+
+	announce("discid_id_decode");
+	evaluate(discid_id_decode(discid_get_id(d), decoded)
+		 && memcmp(decoded, digest, sizeof digest) == 0);
+
+	announce("discid_id_decode_invalid");
+	evaluate(!discid_id_decode("xUp1F2NkfP8s8jaeFn_Av3jNEI4", decoded)
+		 && !discid_id_decode("xUp1F2NkfP8s8jaeFn_Av3jNEI4=", decoded)
+		 && !discid_id_decode("xUp1F2NkfP8s8jaeFn+Av3jNEI4-", decoded)
+		 && !discid_id_decode("xUp1F2NkfP8s8jaeFn_Av3jNEI5-", decoded));
+
+	announce("discid_id_decode_bulk");
+	memcpy(ids, "xUp1F2NkfP8s8jaeFn_Av3jNEI4-", DISCID_ID_LENGTH);
+	memcpy(ids + DISCID_ID_LENGTH, "xUp1F2NkfP8s8jaeFn_Av3jNEI4=",
+	       DISCID_ID_LENGTH + 1);
+	evaluate(discid_id_decode_bulk(ids, 2, digests) == 1
+		 && memcmp(digests, digest, sizeof digest) == 0);
+
 	/* FreeDB DiscID */
 	announce("discid_get_freedb_id");
 	evaluate(equal_str(discid_get_freedb_id(d), "370fce16"));
 
+	/* AccurateRip disc ID */
+	announce("discid_get_accuraterip_id");
+	evaluate(equal_str(discid_get_accuraterip_id(d),
+			   "022-00340bc2-0343cfc1-370fce16"));
+
+	/* the weights start at 1 for the first track */
+	announce("discid_get_accuraterip_id first track 3");
+	d2 = discid_new();
+	memset(offsets2, 0, sizeof offsets2);
+	offsets2[0] = 3000;
+	offsets2[3] = 150;
+	offsets2[4] = 1000;
+	offsets2[5] = 2000;
+	evaluate(discid_put(d2, 3, 5, offsets2)
+		 && strncmp(discid_get_accuraterip_id(d2),
+			    "003-000015ae-000048db-", 22) == 0);
+	discid_free(d2);
+
+	/* CUETools database TOC ID */
+	announce("discid_get_ctdb_id");
+	evaluate(equal_str(discid_get_ctdb_id(d),
+			   "3k1FhYf6et1dZk6it2a56gsACks-"));
+
 	/* MusicBrainz TOC string */
 	announce("discid_get_toc_string");
 	expected = "1 22 303602 150 9700 25887 39297 53795 63735 77517 94877 107270 123552 135522 148422 161197 174790 192022 205545 218010 228700 239590 255470 266932 288750";
@@ -107,6 +245,83 @@ int main(int argc, char *argv[]) {
 	announce("discid_get_error_msg");
 	evaluate(strlen(discid_get_error_msg(d)) == 0);
 
+	announce("discid_compute_batch");
+	evaluate(test_batch(d, offsets));
+
+	announce("discid_cache_enable");
+	evaluate(discid_cache_enable(100) && !discid_cache_enable(0));
+
+	announce("discid_cache_get_stats");
+	discid_cache_enable(100);
+	discid_put(d, 1, 22, offsets);
+	discid_put(d, 1, 21, offsets);
+	discid_put(d, 1, 22, offsets);
+	discid_cache_get_stats(&hits, &misses);
+	evaluate(equal_str(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-")
+		 && equal_int((int) hits, 1) && equal_int((int) misses, 2));
+	discid_cache_disable();
+
+	announce("discid_compare shift");
+	evaluate(test_compare(d, offsets, 0, 100, &comparison)
+		 && comparison.same_tracks && comparison.constant_shift
+		 && equal_int(comparison.shift, 100)
+		 && equal_int(comparison.max_deviation, 0)
+		 && equal_int(comparison.leadout_delta, 100)
+		 && !comparison.xa_equal);
+
+	announce("discid_compare track");
+	evaluate(test_compare(d, offsets, 5, -10, &comparison)
+		 && comparison.same_tracks && !comparison.constant_shift
+		 && equal_int(comparison.shift, 0)
+		 && equal_int(comparison.max_deviation, 10)
+		 && equal_int(comparison.leadout_delta, 0)
+		 && !comparison.xa_equal);
+
+	announce("discid_compare equal");
+	evaluate(test_compare(d, offsets, 1, 0, &comparison)
+		 && comparison.constant_shift && comparison.xa_equal);
+
+	announce("discid_compare data track");
+	evaluate(test_compare(d, offsets, -1, 0, &comparison)
+		 && !comparison.same_tracks && !comparison.constant_shift
+		 && equal_int(comparison.max_deviation, 0)
+		 && comparison.xa_equal);
+
+	announce("discid_get_variants");
+	discid_put(d, 1, 22, offsets);
+	evaluate(equal_int((int) discid_get_variants(d, 1, variants, 9), 9)
+		 && equal_int(variants[1].leadout, offsets[0])
+		 && equal_str(variants[1].id, "xUp1F2NkfP8s8jaeFn_Av3jNEI4-")
+		 && equal_int(variants[0].leadout, offsets[0] - 1)
+		 && equal_int(variants[3].last, 21)
+		 && equal_int(variants[4].leadout, offsets[22] - 11400)
+		 && equal_int(variants[7].leadout, offsets[22]));
+
+	announce("discid_get_variants data track");
+	memcpy(enhanced, offsets, sizeof(int) * 23);
+	enhanced[23] = offsets[0] + 11400;
+	enhanced[0] = enhanced[23] + 20000;
+	discid_put(d, 1, 23, enhanced);
+	evaluate(equal_int((int) discid_get_variants(d, 2, variants, 9), 9)
+		 && equal_str(variants[7].id, "xUp1F2NkfP8s8jaeFn_Av3jNEI4-"));
+
+	announce("discid_get_track_pregap");
+	memcpy(enhanced, offsets, sizeof(int) * 23);
+	enhanced[1] = 183;
+	discid_put(d, 1, 22, enhanced);
+	evaluate(equal_int(discid_get_track_pregap(d, 1), 33)
+		 && equal_int(discid_get_track_pregap(d, 2), 0));
+
+	announce("discid_get_full_toc");
+	discid_put(d, 1, 22, offsets);
+	evaluate(discid_get_full_toc(d, &toc)
+		 && equal_int(toc.first, 1) && equal_int(toc.last, 22)
+		 && memcmp(toc.offsets, offsets, sizeof(int) * 23) == 0
+		 && equal_int(discid_get_track_control(d, 22), 0)
+		 && equal_str(discid_get_full_id(d), discid_get_id(d))
+		 && equal_str(discid_get_full_freedb_id(d),
+			      discid_get_freedb_id(d)));
+
 	discid_free(d);
 
 	return !test_result();
@@ -139,6 +139,9 @@ int main(int argc, char *argv[]) {
 	free(track_offsets);
 	discid_free(d2);
 
+	announce("discid_read_quick known disc");
+	evaluate(equal_int(discid_read_quick(d, device, 0), 2));
+
 	announce("discid_get_error_msg");
 	evaluate(strlen(discid_get_error_msg(d)) == 0);
 
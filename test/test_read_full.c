@@ -21,6 +21,7 @@
 --------------------------------------------------------------------------- */
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #include <discid/discid.h>
 #include "test.h"
@@ -28,6 +29,7 @@
 
 int main(int argc, char *argv[]) {
 	DiscId *d;
+	DiscId *d2;
 	int i, first, last;
 	int found, invalid;
 	char *mcn;
@@ -106,9 +108,44 @@ int main(int argc, char *argv[]) {
 		evaluate(!invalid && !found);
 	}
 
+	/* Most discs don't have CD-TEXT */
+	announce("discid_get_cdtext");
+	if (discid_has_feature(DISCID_FEATURE_CDTEXT)) {
+		evaluate(discid_get_cdtext(d, 0, DISCID_CDTEXT_TITLE) != NULL
+			 && discid_get_cdtext(d, last,
+					      DISCID_CDTEXT_PERFORMER) != NULL);
+	} else {
+		evaluate(strlen(discid_get_cdtext(d, 0,
+						  DISCID_CDTEXT_TITLE)) == 0);
+	}
+
+	/* The pregaps have to be within the previous track */
+	announce("discid_get_track_pregap");
+	invalid = 0;
+	for (i=first+1; i<=last; i++) {
+		if (discid_get_track_pregap(d, i) < 0
+			|| discid_get_track_pregap(d, i)
+				>= discid_get_track_length(d, i-1)) {
+			invalid++;
+		}
+	}
+	evaluate(!invalid
+		 && equal_int(discid_get_track_pregap(d, first),
+			      discid_get_track_offset(d, first) - 150));
+
 	announce("discid_get_error_msg");
 	evaluate(strlen(discid_get_error_msg(d)) == 0);
 
+	announce("discid_read_progressive");
+	d2 = discid_new();
+	evaluate(discid_read_progressive(d2, device, UINT_MAX)
+		 && equal_str(discid_get_id(d2), discid_get_id(d)));
+
+	announce("discid_wait");
+	evaluate(discid_wait(d2)
+		 && equal_str(discid_get_mcn(d2), discid_get_mcn(d)));
+	discid_free(d2);
+
 
 	discid_free(d);
 
@@ -0,0 +1,169 @@
+/* --------------------------------------------------------------------------
+
+   MusicBrainz -- The Internet music metadatabase
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see
+   <https://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------- */
+/*
+ * Stress test and benchmark for using libdiscid from many threads.
+ *
+ * Every thread puts TOCs into its own DiscId objects and compares the
+ * results, reads the getters of one DiscId object shared by all threads
+ * and tries to read a disc every now and then.
+ * The number of operations per second is printed for every thread count.
+ *
+ * To check for data races build with ThreadSanitizer,
+ * for example with cmake -DENABLE_TSAN=ON.
+ *
+ * An optional first parameter is the device to read from,
+ * an optional second parameter the number of iterations per thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <discid/discid.h>
+#include "test.h"
+
+#define MAX_THREADS 16
+#define DEFAULT_ITERATIONS 20000
+/* read attempts are slow, only do one every READ_INTERVAL iterations */
+#define READ_INTERVAL 5000
+
+
+static int offsets[] = {
+	303602,
+	150, 9700, 25887, 39297, 53795, 63735, 77517, 94877, 107270,
+	123552, 135522, 148422, 161197, 174790, 192022, 205545,
+	218010, 228700, 239590, 255470, 266932, 288750,
+};
+
+static DiscId *shared;
+static const char *device;
+static int iterations = DEFAULT_ITERATIONS;
+
+typedef struct {
+	pthread_t thread;
+	long operations;
+	int errors;
+} worker;
+
+
+static void *run_worker(void *arg) {
+	worker *w = (worker *) arg;
+	DiscId *d, *d_read;
+	char device_name[64];
+	unsigned char digest[DISCID_DIGEST_LENGTH];
+	int i;
+
+	d = discid_new();
+	d_read = discid_new();
+
+	for (i = 0; i < iterations; i++) {
+		/* private handle, same TOC as the shared one */
+		if (!discid_put(d, 1, 22, offsets)
+			|| strcmp(discid_get_id(d), "xUp1F2NkfP8s8jaeFn_Av3jNEI4-")
+			|| strcmp(discid_get_freedb_id(d), "370fce16"))
+			w->errors++;
+
+		/* shared read-only handle */
+		if (strcmp(discid_get_id(shared), discid_get_id(d))
+			|| strcmp(discid_get_toc_string(shared),
+				  discid_get_toc_string(d))
+			|| strcmp(discid_get_submission_url(shared),
+				  discid_get_submission_url(d))
+			|| !discid_get_id_binary(shared, digest))
+			w->errors++;
+
+		if (!discid_get_default_device_r(device_name,
+						 sizeof device_name))
+			w->errors++;
+
+		if (i % READ_INTERVAL == 0) {
+			/* failing is fine, there might be no disc */
+			discid_read_sparse(d_read, device, 0);
+			w->operations++;
+		}
+		w->operations += 8;
+	}
+
+	discid_free(d_read);
+	discid_free(d);
+
+	return NULL;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Run with the given number of threads and print the operations per second */
+static int run(int num_threads) {
+	worker workers[MAX_THREADS];
+	long operations = 0;
+	int i, errors = 0;
+	double start, seconds;
+
+	memset(workers, 0, sizeof workers);
+	start = now();
+	for (i = 0; i < num_threads; i++) {
+		pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]);
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		operations += workers[i].operations;
+		errors += workers[i].errors;
+	}
+	seconds = now() - start;
+
+	printf("%.0f ops/s ... ", operations / seconds);
+
+	if (errors) {
+		snprintf(details, sizeof details,
+			 "\t%d inconsistent results\n", errors);
+	}
+	return errors == 0;
+}
+
+int main(int argc, char *argv[]) {
+	int num_threads;
+	char name[64];
+
+	device = argc > 1 ? argv[1] : NULL;
+	if (argc > 2)
+		iterations = atoi(argv[2]);
+
+	shared = discid_new();
+
+	announce("discid_put (shared)");
+	evaluate(discid_put(shared, 1, 22, offsets));
+
+	for (num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+		snprintf(name, sizeof name, "%2d threads", num_threads);
+		announce(name);
+		evaluate(run(num_threads));
+	}
+
+	discid_free(shared);
+
+	return !test_result();
+}
+
+/* EOF */